@@ -8,562 +8,4467 @@
 #pragma once
 
 #include <getopt.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
 #include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
 #include <vector>
+#include <deque>
 #include <map>
+#include <memory>
+#include <unordered_map>
+#include <charconv>
+#include <chrono>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Exception-free build mode
+ *
+ * When the code is compiled without exceptions (e.g. -fno-exceptions), or
+ * CMDOPTION_NO_EXCEPTIONS is defined explicitly, nothing in this file throws.
+ * The fallible calls have counterparts returning an Expected<T> (see
+ * StringValue::tryAs() and CmdOption::tryGet()), and the throwing shorthands
+ * such as as<>() and operator[] abort the program on failure instead.
+ */
+#if !defined(CMDOPTION_NO_EXCEPTIONS) && !defined(__cpp_exceptions) && !defined(__EXCEPTIONS)
+#define CMDOPTION_NO_EXCEPTIONS
+#endif
+
+#ifdef CMDOPTION_NO_EXCEPTIONS
+#define CMDOPTION_THROW(e) std::abort()
+#else
+#define CMDOPTION_THROW(e) throw e
+#endif
+
+/*
+ * Instrumentation
+ *
+ * Define CMDOPTION_STATS to have each CmdOption record the time spent in its
+ * phases and count the work done, see ParseStats. Without it, the
+ * instrumentation is compiled out completely.
+ */
+#ifdef CMDOPTION_STATS
+#include <functional>
+#define CMDOPTION_STAT(x) x
+#else
+#define CMDOPTION_STAT(x)
+#endif
 
 namespace tianbo {
+
+#ifdef CMDOPTION_STATS
 /**
- * This classes store a value in its string form, it can be convert to desired
- * types when needed. This is used as return type of CmdOption's [] operator.
+ * Statistics of a CmdOption object, available with CMDOPTION_STATS.
  *
- * As per performance, the class is a light-weight wrapper of original string,
- * the overhead is minimal.
+ * Times are in nanoseconds and accumulate over calls. The allocations are
+ * counted where the storage of a result grows: the option values, the pairs
+ * and elements of maps and lists, the arguments, the positionals, the
+ * forwarded elements and the records of incremental parsing, and the
+ * subcommands. A call that grows a storage counts once.
  */
+struct ParseStats
+{
+    std::uint64_t initNs = 0;       // reading the usage text
+    std::uint64_t parseNs = 0;      // scanning argv in parse()
+    std::uint64_t convertNs = 0;    // converting values with as<>() and alike
 
-class StringValue
+    std::uint64_t optionHits = 0;       // options found on the command line
+    std::uint64_t conversions = 0;      // values converted
+    std::uint64_t conversionErrors = 0; // values failed to convert
+    std::uint64_t cacheHits = 0;        // results reused instead of rebuilt
+    std::uint64_t allocations = 0;      // heap allocations for the results
+};
+
+/**
+ * Add the time elapsed in its scope to a counter
+ */
+class StatTimer
 {
 private:
-    // store the string value(s), if multiple strings are added ( see add() ),
-    // those strings are separated by "\n".
-    std::string m_text;
+    std::uint64_t & m_ns;
+    std::chrono::steady_clock::time_point m_start;
 
-    // number of strings that have been stored
-    int m_count = 0;
+public:
+    explicit StatTimer(std::uint64_t & ns)
+        : m_ns(ns), m_start(std::chrono::steady_clock::now())
+    {
+        // do nothing
+    }
+
+    ~StatTimer()
+    {
+        m_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - m_start).count();
+    }
+};
+#endif
+
+/**
+ * A value of type T or an error, returned by the fallible calls so that they
+ * can be used without exceptions.
+ *
+ * The error is a static message, so a failed call never allocates.
+ */
+template<typename T>
+class Expected
+{
+private:
+    T m_value{};
+    const char * m_error = nullptr;
 
 public:
     /**
-     * default constructor
+     * Construct a successful result
+     *
+     * @param v
+     * the value
      */
-    StringValue()
+    Expected(const T & v) : m_value(v)
     {
         // do nothing
     }
 
     /**
-     * Constructor
-     *
-     * In most cases, this constructor is used to construct the object with a
-     * string.
-     *
-     * @param str
-     * a string
+     * Overload of the constructor taking the value over
      */
-    StringValue(const std::string & str)
+    Expected(T && v) : m_value(std::move(v))
     {
-        m_text = str;
-        m_count = 1;
+        // do nothing
     }
 
     /**
-     * Add a new string to the string value
+     * Construct a failed result
      *
-     * @param str
-     * a new string
+     * @param error
+     * a static error message
      */
-    void add(const std::string & str)
+    static Expected failure(const char * error)
     {
-        if (m_count == 0) {
-            m_text = str;
-        }
-        else {
-            m_text += "\n" + str;
-        }
-        ++m_count;
+        Expected e;
+        e.m_error = error;
+        return e;
     }
 
     /**
-     * Check if the object has been initialized
-     *
-     * @return
-     * true in case the object is initialized.
+     * Check if the result holds a value
      */
     explicit operator bool() const
     {
-        return (m_count > 0);
+        return m_error == nullptr;
     }
 
     /**
-     * Get number of values the object stores
+     * Get the value
      *
-     * @return
-     * number of values the object stores
+     * @throw
+     * std::invalid_argument if the result holds an error. Without exceptions
+     * the program is aborted instead.
      */
-    int count() const
+    const T & value() const &
     {
-        return m_count;
+        if (m_error != nullptr) {
+            CMDOPTION_THROW(std::invalid_argument(m_error));
+        }
+        return m_value;
     }
 
     /**
-     * Implicit conversion operator
-     *
-     * It is essentially a short hand to as<>()
+     * Overload of value() for a temporary result, the value is moved out
      */
-    template<typename T>
-    operator T() const
+    T value() &&
     {
-        return as<T>();
+        if (m_error != nullptr) {
+            CMDOPTION_THROW(std::invalid_argument(m_error));
+        }
+        return std::move(m_value);
     }
 
     /**
-     * A short hand of as<std::string>().
-     *
-     * Example:
-     * StringValue sv("abc");
-     * std::string s;
-     * s = sv.str();
-     *
-     * Note that the above can be done implicitly:
-     *
-     * StringValue sv("foo");
-     * std::string s = sv;
-     *
-     * The problem of implicit conversion for std::string is that it works only
-     * for copy constructor. The following case does not work as it is
-     * ambiguous (note StringValue -> int -> char -> std::string):
-     *
-     * std::string s;
-     * s = sv;
-     *
-     * The workaround is to use the as<> function:
-     *
-     * s = sv.as<std::string>();
-     *
-     * As string is quite common type, we provide the function str() as a
-     * shorthand replacement.
+     * Get the value or the default value @c t in case of error
      */
-    std::string str() const
+    T valueOr(T t) const
     {
-        return as<std::string>();
+        return (m_error == nullptr)? m_value: t;
     }
 
     /**
-     * Get the value of type T from the object.
-     *
-     * If the object was not initialized, use the default value @c t instead
-     *
-     * @param t
-     * Default value
-     *
-     * @return
-     * the value from the object if possible or t if otherwise
+     * Get the error message, nullptr if there is no error
      */
-    template<typename T>
-    T valueOr(T t) const
+    const char * error() const
     {
-        T ret;
-        if (m_count == 0) {
-            ret = t;
+        return m_error;
+    }
+
+private:
+    Expected()
+    {
+        // do nothing
+    }
+};
+
+/**
+ * The key=value pairs of an option given many times, e.g. "-D key=value"
+ *
+ * The keys and values are views into argv, so nothing is copied. The pairs
+ * are kept in the order they were first given, and a key given again takes
+ * the new value. Keys are found through an open-addressing hash table of
+ * positions in that order.
+ */
+class KeyValueMap
+{
+public:
+    typedef std::pair<std::string_view, std::string_view> Entry;
+    typedef std::vector<Entry>::const_iterator const_iterator;
+
+    /**
+     * Add a pair, or set the value of a key already there
+     */
+    void insert(std::string_view key, std::string_view value)
+    {
+        if ((m_entries.size() + 1) * 2 > m_slots.size()) {
+            rehash(m_slots.empty()? 16: m_slots.size() * 2);
         }
-        else {
-            try {
-                ret = as<T>();
-            }
-            catch (...) {
-                ret = t;
-            }
+
+        int & slot = m_slots[lookup(key)];
+        if (slot >= 0) {
+            m_entries[slot].second = value;
+            return;
         }
-        return ret;
+        slot = static_cast<int>(m_entries.size());
+        m_entries.emplace_back(key, value);
     }
 
     /**
-     *  Overload of valueOr for C string
+     * Add a pair from a string such as "key=value", a string without '=' is
+     * a key with an empty value
      */
-    std::string valueOr(const char * pstr) const
+    void insert(std::string_view pair)
     {
-        std::string ret;
-        if (m_count == 0) {
-            if (pstr != nullptr) {
-                ret = pstr;
-            }
+        auto pos = pair.find('=');
+        if (pos == std::string_view::npos) {
+            insert(pair, std::string_view());
         }
         else {
-            ret = m_text;
+            insert(pair.substr(0, pos), pair.substr(pos + 1));
         }
-        return ret;
     }
 
     /**
-     * Interpret the string as value in given type T
-     *
-     * @tparam T
-     * Template parameter T can be int, long, float, double or std::string
+     * Find the value of a key
      *
      * @return
-     * Value in type T
-     *
-     * @throw
-     * std::invalid_argument if the conversion cannot be done.
+     * a pointer to the value, or nullptr if the key was not given
      */
-    template<typename T>
-    T as() const
+    const std::string_view * find(std::string_view key) const
     {
-        validate();
-        T v;
-        getValue(m_text, v);
-        return v;
+        if (m_entries.empty()) {
+            return nullptr;
+        }
+        int slot = m_slots[lookup(key)];
+        return (slot >= 0)? &m_entries[slot].second: nullptr;
     }
 
-private:
-
-    // check if the object has been initialized
-    void validate() const
+    /**
+     * Get the value of a key, or v if the key was not given
+     */
+    std::string_view valueOr(std::string_view key, std::string_view v) const
     {
-        if (m_count == 0) {
-            throw std::invalid_argument("null value");
-        }
+        const std::string_view * value = find(key);
+        return (value != nullptr)? *value: v;
     }
 
-    // the implementation of as() function, it assumes the parameter is valid
-    template<typename T>
-    void getValue(const std::string & str, T& v) const
+    /**
+     * Remove the pairs, the memory is kept for reuse
+     */
+    void clear()
     {
-        std::size_t pos;
-        stox(str, &pos, v);
-        if (pos != str.length()) {
-            throw std::invalid_argument("stox");
+        if (!m_entries.empty()) {
+            m_entries.clear();
+            std::fill(m_slots.begin(), m_slots.end(), -1);
         }
     }
 
-    // overload version of getValue() for std::string
-    void getValue(const std::string & str, std::string & v) const
+    std::size_t size() const
     {
-        v = str;
+        return m_entries.size();
     }
 
-    /*
-     * Interpret the string as a vector
-     *
-     * The strings added by add() function are stored internaly as "\n"
-     * separated string. The string is parsed again to get the returned vector.
-     *
-     * In case there is only one string added, the return vector size will be 1.
-     *
-     * @tparam T
-     * Template parameter T can be int, long, float, double or std::string
-     *
-     * @throw
-     * std::invalid_argument if the conversion cannot be done.
+    /**
+     * Get the number of pairs the map holds without allocating memory
      */
-    template<typename T>
-    void getValue(const std::string & str, std::vector<T> & vec) const
+    std::size_t capacity() const
     {
-        std::stringstream s(m_text);
-        std::string line;
+        return std::min(m_entries.capacity(), m_slots.size() / 2);
+    }
 
-        while (std::getline(s, line)) {
-            T v;
-            getValue(line, v);
-            vec.push_back(v);
-        }
+    bool empty() const
+    {
+        return m_entries.empty();
     }
 
-    // overload versions of stoi, stol, stof, stod
+    const_iterator begin() const
+    {
+        return m_entries.begin();
+    }
 
-    void stox(const std::string & str, std::size_t * pos, int & v) const
+    const_iterator end() const
     {
-        v = std::stoi(str, pos);
+        return m_entries.end();
     }
 
-    void stox(const std::string & str, std::size_t * pos, long & v) const
+private:
+    // FNV-1a
+    static std::size_t hash(std::string_view key)
     {
-        v = std::stol(str, pos);
+        std::uint32_t h = 2166136261u;
+        for (char c : key) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 16777619u;
+        }
+        return h;
     }
 
-    void stox(const std::string & str, std::size_t * pos, float & v) const
+    // find the slot of the key, or the empty slot where it belongs
+    std::size_t lookup(std::string_view key) const
     {
-        v = std::stof(str, pos);
+        std::size_t mask = m_slots.size() - 1;
+        std::size_t i = hash(key) & mask;
+        while (m_slots[i] >= 0 && m_entries[m_slots[i]].first != key) {
+            i = (i + 1) & mask;
+        }
+        return i;
     }
 
-    void stox(const std::string & str, std::size_t * pos, double & v) const
+    void rehash(std::size_t size)
     {
-        v = std::stod(str, pos);
+        m_slots.assign(size, -1);
+        for (std::size_t e = 0; e < m_entries.size(); ++e) {
+            m_slots[lookup(m_entries[e].first)] = static_cast<int>(e);
+        }
     }
+
+    std::vector<Entry> m_entries;   // in the order given
+    std::vector<int> m_slots;       // position in m_entries, -1 if empty
 };
 
+namespace detail {
+
 /**
- * This class represents command line options
+ * Convert a string to a double with strtod(), the whole string must be
+ * consumed
  *
- * The major difference from other existing solutions is that this class do not
- * require manually adding option definitions. Instead, it adds those definition
- * by parsing usage text.
+ * std::from_chars() for floating point is missing from some standard
+ * libraries, e.g. libc++ before LLVM 20. The string is copied to terminate
+ * it, on the stack unless it is long. Leading whitespace, which strtod()
+ * skips, is rejected.
+ */
+inline bool toDouble(std::string_view str, double & v)
+{
+    if (str.empty() || std::isspace(static_cast<unsigned char>(str[0]))) {
+        return false;
+    }
+
+    char buf[64];
+    std::string copy;
+    const char * p = buf;
+    if (str.length() < sizeof(buf)) {
+        std::memcpy(buf, str.data(), str.length());
+        buf[str.length()] = 0;
+    }
+    else {
+        copy.assign(str.data(), str.length());
+        p = copy.c_str();
+    }
+
+    char * end;
+    errno = 0;
+    v = std::strtod(p, &end);
+    return (end == p + str.length()) && (errno != ERANGE);
+}
+
+} // end of namespace detail
+
+/**
+ * Convert a string to a number, the whole string must be consumed
  *
- * Another minor difference is that accessing parsed options can be done with
- * implicit conversion along with explicit means. Those conversions are done
- * with the class StringValue. See above for more information.
+ * Unlike the strtol() family, the string does not need to be terminated,
+ * so pieces of a longer string can be converted in place. As with strtol(),
+ * a leading '+' is accepted, but leading whitespace is not.
  */
-class CmdOption
+template<typename T>
+bool fromChars(std::string_view str, T & v)
 {
+    if (!str.empty() && str[0] == '+') {
+        str.remove_prefix(1);
+        if (!str.empty() && str[0] == '-') {
+            return false;
+        }
+    }
+    auto result = std::from_chars(str.data(), str.data() + str.length(), v);
+    return result.ec == std::errc() && result.ptr == str.data() + str.length();
+}
 
-public:
-    /**
-     * Initialize the options with usage text
-     *
-     * @param usage
-     * The usage text following the linux system manual page style. For example:
-     *
-     *
-     * -a, --all show all elements, no arguments required
-     * -b, --batch  this option is separated by more than one space
-     * -c  no long option and no argument required
-     * -d --delta=NUM set delta number, need argument
-     * -e --epsilon[=NUM] requires optional argument
-     *     with or without comma ',' after short option are OK
-     *     the lines not started with '-' will be ignored
-     *
-     * -f FILE
-     *     delete a file, no long option, need argument; in this case,
-     *     explanation must be in separate line
+/**
+ * Overload of fromChars for double, see detail::toDouble()
+ */
+inline bool fromChars(std::string_view str, double & v)
+{
+    return detail::toDouble(str, v);
+}
+
+/**
+ * Overload of fromChars for float, a number too large for float fails
+ */
+inline bool fromChars(std::string_view str, float & v)
+{
+    double d;
+    if (!detail::toDouble(str, d) || (std::isfinite(d) && std::fabs(d) > FLT_MAX)) {
+        return false;
+    }
+    v = static_cast<float>(d);
+    return true;
+}
+
+
+/**
+ * Overload of fromChars for std::string
+ */
+inline bool fromChars(std::string_view str, std::string & v)
+{
+    v.assign(str.data(), str.length());
+    return true;
+}
+
+/**
+ * A number of bytes, read from values such as "512M" or "1.5GiB"
+ *
+ * The multiples are binary: "k", "K", "KB" and "KiB" all stand for 1024
+ * bytes, and so on with M, G, T, P and E. "B" or no suffix is bytes.
+ */
+struct ByteSize
+{
+    std::uint64_t bytes = 0;
+};
+
+/**
+ * A number of events per second, read from values such as "10k/s" or
+ * "300/min"
+ *
+ * The multiples k, M and G are decimal, the time units are those of the
+ * durations.
+ */
+struct Rate
+{
+    double perSecond = 0;
+};
+
+namespace detail {
+
+/**
+ * A unit suffix and the number it multiplies by
+ */
+struct UnitSuffix
+{
+    std::string_view name;
+    std::uint64_t factor;
+};
+
+// binary multiples of ByteSize
+inline constexpr UnitSuffix SIZE_UNITS[] = {
+    {"", 1}, {"B", 1},
+    {"k", 1ull << 10}, {"K", 1ull << 10}, {"KB", 1ull << 10}, {"KiB", 1ull << 10},
+    {"M", 1ull << 20}, {"MB", 1ull << 20}, {"MiB", 1ull << 20},
+    {"G", 1ull << 30}, {"GB", 1ull << 30}, {"GiB", 1ull << 30},
+    {"T", 1ull << 40}, {"TB", 1ull << 40}, {"TiB", 1ull << 40},
+    {"P", 1ull << 50}, {"PB", 1ull << 50}, {"PiB", 1ull << 50},
+    {"E", 1ull << 60}, {"EB", 1ull << 60}, {"EiB", 1ull << 60}
+};
+
+// time units in nanoseconds
+inline constexpr UnitSuffix TIME_UNITS[] = {
+    {"ns", 1}, {"us", 1000}, {"ms", 1000000}, {"s", 1000000000},
+    {"m", 60000000000ull}, {"min", 60000000000ull}, {"h", 3600000000000ull},
+    {"d", 86400000000000ull}
+};
+
+// decimal multiples of Rate
+inline constexpr UnitSuffix COUNT_UNITS[] = {
+    {"", 1}, {"k", 1000}, {"M", 1000000}, {"G", 1000000000}
+};
+
+/**
+ * Read a non-negative number such as "12" or "1.5" from the start of str
+ *
+ * @param str
+ * the string, the number is removed from its start
+ *
+ * @param whole
+ * the number if it has no fraction
+ *
+ * @param real
+ * the number if it has a fraction
+ *
+ * @return
+ * 0 if there is no valid number, 1 for a whole number, 2 for a fraction
+ */
+inline int readNumber(std::string_view & str, std::uint64_t & whole, double & real)
+{
+    const char * begin = str.data();
+    const char * end = begin + str.length();
+    auto result = std::from_chars(begin, end, whole);
+    if (result.ec != std::errc()) {
+        return 0;
+    }
+
+    const char * stop = result.ptr;
+    int kind = 1;
+    if (stop != end && *stop == '.') {
+        // only the digits of the fraction, strtod() would take an exponent
+        do {
+            ++stop;
+        } while (stop != end && *stop >= '0' && *stop <= '9');
+        if (!toDouble(std::string_view(begin, stop - begin), real)) {
+            return 0;
+        }
+        kind = 2;
+    }
+    str.remove_prefix(stop - begin);
+    return kind;
+}
+
+/**
+ * Remove the unit suffix from the start of str and find its factor
+ *
+ * @param letters
+ * true to take the letters only, e.g. "ms" of "ms30s", false to take the
+ * rest of the string
+ *
+ * @return
+ * the factor, or 0 if the suffix is not in the table
+ */
+template<std::size_t N>
+std::uint64_t readUnit(std::string_view & str, const UnitSuffix (&table)[N], bool letters)
+{
+    std::size_t len = 0;
+    while (len < str.length() && (!letters || std::isalpha(static_cast<unsigned char>(str[len])))) {
+        ++len;
+    }
+
+    std::string_view name = str.substr(0, len);
+    str.remove_prefix(len);
+    for (const UnitSuffix & unit : table) {
+        if (name == unit.name) {
+            return unit.factor;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Multiply a number by a factor into v, checking the result fits
+ */
+inline bool scale(int kind, std::uint64_t whole, double real, std::uint64_t factor,
+        std::uint64_t limit, std::uint64_t & v)
+{
+    if (kind == 1) {
+        if (whole > limit / factor) {
+            return false;
+        }
+        v = whole * factor;
+        return true;
+    }
+
+    double d = real * static_cast<double>(factor) + 0.5;
+    if (!(d < static_cast<double>(limit))) {
+        return false;
+    }
+    v = static_cast<std::uint64_t>(d);
+    return true;
+}
+
+/**
+ * Read a duration such as "250ms" or "1h30m" in nanoseconds, a unit is
+ * required after each number other than a single "0"
+ */
+inline bool readDuration(std::string_view str, std::int64_t & ns)
+{
+    if (str == "0") {
+        ns = 0;
+        return true;
+    }
+
+    std::uint64_t total = 0;
+    do {
+        std::uint64_t whole;
+        double real;
+        std::uint64_t part;
+        int kind = readNumber(str, whole, real);
+        std::uint64_t factor = kind? readUnit(str, TIME_UNITS, true): 0;
+        if (factor == 0 || !scale(kind, whole, real, factor, INT64_MAX, part) ||
+                part > INT64_MAX - total) {
+            return false;
+        }
+        total += part;
+    } while (!str.empty());
+
+    ns = static_cast<std::int64_t>(total);
+    return true;
+}
+
+} // end of namespace detail
+
+/**
+ * Overload of fromChars for ByteSize
+ */
+inline bool fromChars(std::string_view str, ByteSize & v)
+{
+    std::uint64_t whole;
+    double real;
+    int kind = detail::readNumber(str, whole, real);
+    std::uint64_t factor = kind? detail::readUnit(str, detail::SIZE_UNITS, false): 0;
+    return factor != 0 && detail::scale(kind, whole, real, factor, UINT64_MAX, v.bytes);
+}
+
+/**
+ * Overload of fromChars for std::chrono durations
+ *
+ * A value that is not a whole number of the duration's ticks, e.g. "1500ms"
+ * for std::chrono::seconds, is not accepted.
+ */
+template<typename Rep, typename Period>
+bool fromChars(std::string_view str, std::chrono::duration<Rep, Period> & v)
+{
+    std::int64_t ns;
+    if (!detail::readDuration(str, ns)) {
+        return false;
+    }
+
+    typedef std::chrono::duration<Rep, Period> Duration;
+    std::chrono::nanoseconds exact(ns);
+    v = std::chrono::duration_cast<Duration>(exact);
+    return std::chrono::treat_as_floating_point<Rep>::value ||
+            std::chrono::duration_cast<std::chrono::nanoseconds>(v) == exact;
+}
+
+/**
+ * Overload of fromChars for Rate
+ */
+inline bool fromChars(std::string_view str, Rate & v)
+{
+    auto slash = str.find('/');
+    if (slash == std::string_view::npos) {
+        return false;
+    }
+
+    std::string_view count = str.substr(0, slash);
+    std::string_view unit = str.substr(slash + 1);
+    std::uint64_t whole;
+    double real;
+    int kind = detail::readNumber(count, whole, real);
+    std::uint64_t factor = kind? detail::readUnit(count, detail::COUNT_UNITS, false): 0;
+    std::uint64_t ns = detail::readUnit(unit, detail::TIME_UNITS, false);
+    if (factor == 0 || ns == 0) {
+        return false;
+    }
+
+    double n = (kind == 1)? static_cast<double>(whole): real;
+    v.perSecond = n * static_cast<double>(factor) * 1e9 / static_cast<double>(ns);
+    return true;
+}
+
+/**
+ * The conversion of option values to type T
+ *
+ * The value is passed as a view of the original string, so a conversion
+ * needs no copy of it. The types known to fromChars() are converted by
+ * default. Specialize the template to convert other types, e.g.
+ *
+ * struct CpuMask { std::uint64_t bits; };
+ *
+ * template<>
+ * struct tianbo::ValueParser<CpuMask>
+ * {
+ *     static bool parse(std::string_view str, CpuMask & v)
+ *     {
+ *         const char * end = str.data() + str.length();
+ *         auto result = std::from_chars(str.data(), end, v.bits, 16);
+ *         return result.ec == std::errc() && result.ptr == end;
+ *     }
+ * };
+ *
+ * CpuMask mask = command_opt["cpus"].as<CpuMask>();
+ *
+ * The conversion is then used by as<>(), tryAs<>(), valueOr() and the list
+ * options alike.
+ */
+template<typename T>
+struct ValueParser
+{
+    /**
+     * Marks the conversions of this template, whose results for the numbers
+     * may be kept when the values are checked, see IsBuiltinParser
+     */
+    static constexpr bool builtin = true;
+
+    /**
+     * Convert a value
+     *
+     * @return
+     * false if the value cannot be converted
+     */
+    static bool parse(std::string_view str, T & v)
+    {
+        return fromChars(str, v);
+    }
+};
+
+/**
+ * Check if the conversion to type T is the default one of ValueParser, and
+ * not a specialization
+ */
+template<typename T, typename = void>
+struct IsBuiltinParser : std::false_type
+{
+};
+
+template<typename T>
+struct IsBuiltinParser<T, std::void_t<decltype(ValueParser<T>::builtin)>> : std::true_type
+{
+};
+
+/**
+ * The elements of a delimited option value, e.g. "--ids=1,2,3"
+ *
+ * The elements are views into argv, so nothing is copied. An option given
+ * more than once adds its elements to the end.
+ */
+class ValueList
+{
+public:
+    typedef std::vector<std::string_view>::const_iterator const_iterator;
+
+    /**
+     * Split a string at each separator and add the pieces
+     *
+     * The separators are searched 16 bytes at a time where SSE2 is available,
+     * and with memchr() otherwise.
+     */
+    void split(const char * str, std::size_t len, char sep)
+    {
+        std::size_t start = 0;
+        std::size_t i = 0;
+#ifdef __SSE2__
+        const __m128i needle = _mm_set1_epi8(sep);
+        for (; i + 16 <= len; i += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + i));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+            while (mask != 0) {
+                std::size_t pos = i + __builtin_ctz(mask);
+                m_items.emplace_back(str + start, pos - start);
+                start = pos + 1;
+                mask &= mask - 1;
+            }
+        }
+#endif
+        const void * found;
+        while ((found = std::memchr(str + i, sep, len - i)) != nullptr) {
+            std::size_t pos = static_cast<const char *>(found) - str;
+            m_items.emplace_back(str + start, pos - start);
+            start = i = pos + 1;
+        }
+        m_items.emplace_back(str + start, len - start);
+    }
+
+    /**
+     * Convert the elements to type T
+     *
+     * @tparam T
+     * any type with a ValueParser
+     *
+     * @return
+     * the converted elements, or an error if any of them cannot be converted
+     */
+    template<typename T>
+    Expected<std::vector<T>> tryAs() const
+    {
+        std::vector<T> vec(m_items.size());
+        for (std::size_t i = 0; i < m_items.size(); ++i) {
+            if (!ValueParser<T>::parse(m_items[i], vec[i])) {
+                return Expected<std::vector<T>>::failure("invalid value");
+            }
+        }
+        return vec;
+    }
+
+    /**
+     * Convert the elements to type T, see tryAs()
+     *
+     * @throw
+     * std::invalid_argument if an element cannot be converted
+     */
+    template<typename T>
+    std::vector<T> as() const
+    {
+        return tryAs<T>().value();
+    }
+
+    /**
+     * Remove the elements, the memory is kept for reuse
+     */
+    void clear()
+    {
+        m_items.clear();
+    }
+
+    std::size_t size() const
+    {
+        return m_items.size();
+    }
+
+    /**
+     * Get the number of elements the list holds without allocating memory
+     */
+    std::size_t capacity() const
+    {
+        return m_items.capacity();
+    }
+
+    bool empty() const
+    {
+        return m_items.empty();
+    }
+
+    std::string_view operator[](std::size_t i) const
+    {
+        return m_items[i];
+    }
+
+    const_iterator begin() const
+    {
+        return m_items.begin();
+    }
+
+    const_iterator end() const
+    {
+        return m_items.end();
+    }
+
+private:
+    std::vector<std::string_view> m_items;
+};
+
+/**
+ * This classes store a value in its string form, it can be convert to desired
+ * types when needed. This is used as return type of CmdOption's [] operator.
+ *
+ * As per performance, the class is a light-weight wrapper of original string,
+ * the overhead is minimal.
+ */
+
+class StringValue
+{
+private:
+    // store the string value(s), if multiple strings are added ( see add() ),
+    // those strings are separated by "\n".
+    std::string m_text;
+
+    // number of strings that have been stored
+    int m_count = 0;
+
+    // position of the last value in the choices of the option, see choice()
+    int m_choice = -1;
+
+    // the last value was given with the "no-" spelling, see negated()
+    bool m_negated = false;
+
+    // argv index of the last value, see position()
+    int m_position = -1;
+
+    // where the key=value pairs of the option are kept, see map(); shared
+    // with the CmdOption, so that a copy may outlive it
+    std::shared_ptr<KeyValueMap> m_map;
+
+    // where the elements of a delimited option are kept, see list(); shared
+    // with the CmdOption as the map is
+    std::shared_ptr<ValueList> m_list;
+
+    // the last value as converted when it was checked, see setNumber()
+    enum class Number : char {None, Integer, Real};
+    Number m_number = Number::None;
+    long m_integer = 0;
+    double m_real = 0;
+
+#ifdef CMDOPTION_STATS
+    // shared with the CmdOption, so that a copy may outlive it
+    std::shared_ptr<ParseStats> m_stats;
+#endif
+
+public:
+    /**
+     * default constructor
+     */
+    StringValue()
+    {
+        // do nothing
+    }
+
+    /**
+     * Constructor
+     *
+     * In most cases, this constructor is used to construct the object with a
+     * string.
+     *
+     * @param str
+     * a string
+     */
+    StringValue(const std::string & str)
+    {
+        m_text = str;
+        m_count = 1;
+    }
+
+    /**
+     * Add a new string to the string value
+     *
+     * @param str
+     * a new string
+     */
+    void add(const std::string & str)
+    {
+        add(str.data(), str.length());
+    }
+
+    /**
+     * Overload of add for C string, which saves a temporary std::string
+     */
+    void add(const char * str)
+    {
+        add(str, std::strlen(str));
+    }
+
+    /**
+     * Overload of add for a string of given length
+     */
+    void add(const char * str, std::size_t len)
+    {
+        CMDOPTION_STAT(std::size_t capacity = m_text.capacity());
+        if (m_count == 0) {
+            m_text.assign(str, len);
+        }
+        else {
+            m_text += '\n';
+            m_text.append(str, len);
+        }
+        ++m_count;
+        CMDOPTION_STAT(if (m_stats && m_text.capacity() != capacity) ++m_stats->allocations);
+    }
+
+    /**
+     * Remove the strings stored, the memory is kept for reuse
+     */
+    void clear()
+    {
+        m_text.clear();
+        m_count = 0;
+        m_choice = -1;
+        m_negated = false;
+        m_position = -1;
+        m_number = Number::None;
+        if (m_map) {
+            m_map->clear();
+        }
+        if (m_list) {
+            m_list->clear();
+        }
+    }
+
+    /**
+     * Count one more value without storing its text, for switches and for
+     * options whose values are kept elsewhere, see map()
+     *
+     * The count stops at INT_MAX instead of overflowing.
+     */
+    void mark()
+    {
+        if (m_count < INT_MAX) {
+            ++m_count;
+        }
+    }
+
+    /**
+     * Set the argv index of the next value
+     */
+    void setPosition(int position)
+    {
+        m_position = position;
+    }
+
+    /**
+     * Get the argv index of the element the option was last given in
+     *
+     * @return
+     * the index, or -1 if the option was not given or was parsed with
+     * ParseEngine::Getopt, which permutes argv
+     */
+    int position() const
+    {
+        return m_position;
+    }
+
+    /**
+     * Set where the key=value pairs of the option are kept
+     */
+    void setMap(const std::shared_ptr<KeyValueMap> & map)
+    {
+        m_map = map;
+    }
+
+    /**
+     * Set where the elements of a delimited option are kept
+     */
+    void setList(const std::shared_ptr<ValueList> & list)
+    {
+        m_list = list;
+    }
+
+    /**
+     * Get the elements of an option declared with a placeholder such as
+     * "ID,..." or "HOST:...", where the character before "..." separates the
+     * elements
+     *
+     * The elements are split when parsing and refer to the strings of argv,
+     * so they are valid as long as argv is. The values of such an option are
+     * not kept as text, str() gives an empty string, and a conversion to
+     * std::vector converts the elements. A copy of the value shares them
+     * with the parser as map() does.
+     *
+     * @return
+     * the elements of all occurrences of the option, empty if the option
+     * does not take a list
+     */
+    const ValueList & list() const
+    {
+        static const ValueList none;
+        return m_list? *m_list: none;
+    }
+
+    /**
+     * Get the key=value pairs of an option declared with a placeholder such
+     * as "KEY=VALUE"
+     *
+     * The pairs are split when parsing and refer to the strings of argv, so
+     * they are valid as long as argv is. The values of such an option are not
+     * kept as text, str() gives an empty string. A copy of the value shares
+     * the pairs with the parser, so it may outlive the parser and sees the
+     * pairs of a later parse.
+     *
+     * @return
+     * the pairs, empty if the option does not take pairs
+     */
+    const KeyValueMap & map() const
+    {
+        static const KeyValueMap none;
+        return m_map? *m_map: none;
+    }
+
+    /**
+     * Keep the number converted from the next value, so that as<long>() or
+     * as<int>() does not convert it again
+     */
+    void setNumber(long v)
+    {
+        m_number = Number::Integer;
+        m_integer = v;
+    }
+
+    /**
+     * Overload of setNumber for as<double>()
+     */
+    void setNumber(double v)
+    {
+        m_number = Number::Real;
+        m_real = v;
+    }
+
+    /**
+     * Set if the next value is given with the "no-" spelling
+     */
+    void setNegated(bool negated)
+    {
+        m_negated = negated;
+    }
+
+    /**
+     * Check if the option was last given with its "no-" spelling, e.g.
+     * "--no-color" for an option declared as "--[no-]color"
+     */
+    bool negated() const
+    {
+        return m_negated;
+    }
+
+    /**
+     * Get the state of a switch declared as "--[no-]name"
+     *
+     * @param v
+     * the state if the switch is not given
+     *
+     * @return
+     * false if the switch was last given as "--no-name", true if as
+     * "--name", v otherwise
+     */
+    bool flagOr(bool v) const
+    {
+        return (m_count > 0)? !m_negated: v;
+    }
+
+    /**
+     * Set the position of the value in the choices of the option
+     */
+    void setChoice(int choice)
+    {
+        m_choice = choice;
+    }
+
+    /**
+     * Check if the object has been initialized
+     *
+     * @return
+     * true in case the object is initialized.
+     */
+    explicit operator bool() const
+    {
+        return (m_count > 0);
+    }
+
+    /**
+     * Get number of values the object stores
+     *
+     * @return
+     * number of values the object stores
+     */
+    int count() const
+    {
+        return m_count;
+    }
+
+    /**
+     * Get the last value as a position in the choices of the option
+     *
+     * For an option declared as "--mode={fast,safe,debug}", the value "safe"
+     * gives 1. The value is checked when parsing, so no string comparison is
+     * needed here. An enum listing the choices in the same order can be used:
+     *
+     * enum class Mode {Fast, Safe, Debug};
+     * Mode mode = command_opt["mode"].choice<Mode>();
+     *
+     * @return
+     * the position of the value, or -1 if the option has no value or does not
+     * declare choices
+     */
+    int choice() const
+    {
+        return m_choice;
+    }
+
+    /**
+     * Overload of choice() converting the position to an enum type E
+     */
+    template<typename E>
+    E choice() const
+    {
+        return static_cast<E>(m_choice);
+    }
+
+    /**
+     * Implicit conversion operator
+     *
+     * It is essentially a short hand to as<>()
+     */
+    template<typename T>
+    operator T() const
+    {
+        return as<T>();
+    }
+
+    /**
+     * A short hand of as<std::string>().
+     *
+     * Example:
+     * StringValue sv("abc");
+     * std::string s;
+     * s = sv.str();
+     *
+     * Note that the above can be done implicitly:
+     *
+     * StringValue sv("foo");
+     * std::string s = sv;
+     *
+     * The problem of implicit conversion for std::string is that it works only
+     * for copy constructor. The following case does not work as it is
+     * ambiguous (note StringValue -> int -> char -> std::string):
+     *
+     * std::string s;
+     * s = sv;
+     *
+     * The workaround is to use the as<> function:
+     *
+     * s = sv.as<std::string>();
+     *
+     * As string is quite common type, we provide the function str() as a
+     * shorthand replacement.
+     */
+    std::string str() const
+    {
+        return as<std::string>();
+    }
+
+    /**
+     * Get the value of type T from the object.
+     *
+     * If the object was not initialized, use the default value @c t instead
+     *
+     * @param t
+     * Default value
+     *
+     * @return
+     * the value from the object if possible or t if otherwise
+     */
+    template<typename T>
+    T valueOr(T t) const
+    {
+        return tryAs<T>().valueOr(t);
+    }
+
+    /**
+     *  Overload of valueOr for C string
+     */
+    std::string valueOr(const char * pstr) const
+    {
+        std::string ret;
+        if (m_count == 0) {
+            if (pstr != nullptr) {
+                ret = pstr;
+            }
+        }
+        else {
+            ret = m_text;
+        }
+        return ret;
+    }
+
+    /**
+     * Interpret the string as value in given type T
+     *
+     * @tparam T
+     * Template parameter T can be int, long, float, double, std::string or
+     * any other type with a ValueParser
+     *
+     * @return
+     * Value in type T
+     *
+     * @throw
+     * std::invalid_argument if the conversion cannot be done. Without
+     * exceptions the program is aborted instead, use tryAs() to handle the
+     * error.
+     */
+    template<typename T>
+    T as() const
+    {
+        return tryAs<T>().value();
+    }
+
+    /**
+     * Interpret the string as value in given type T without throwing
+     *
+     * @tparam T
+     * See as()
+     *
+     * @return
+     * Value in type T, or an error if the object was not initialized or the
+     * conversion cannot be done.
+     */
+    template<typename T>
+    Expected<T> tryAs() const
+    {
+        if (m_count == 0) {
+            return Expected<T>::failure("null value");
+        }
+
+#ifdef CMDOPTION_STATS
+        ParseStats dummy;
+        ParseStats & stats = m_stats? *m_stats: dummy;
+        StatTimer timer(stats.convertNs);
+        ++stats.conversions;
+#endif
+
+        // the number kept when checking follows the rules of ValueParser,
+        // unless the conversion was specialized
+        T v{};
+        if constexpr (IsBuiltinParser<T>::value) {
+            if (m_count == 1 && cached(v)) {
+                return v;
+            }
+        }
+        if (!getValue(m_text, v)) {
+            CMDOPTION_STAT(++stats.conversionErrors);
+            return Expected<T>::failure("invalid value");
+        }
+        return v;
+    }
+
+#ifdef CMDOPTION_STATS
+    /**
+     * Set where the statistics of conversions are recorded
+     */
+    void setStats(const std::shared_ptr<ParseStats> & stats)
+    {
+        m_stats = stats;
+    }
+#endif
+
+private:
+
+    // get the number kept by setNumber(), if it is of type T
+    template<typename T>
+    bool cached(T &) const
+    {
+        return false;
+    }
+
+    bool cached(long & v) const
+    {
+        v = m_integer;
+        return m_number == Number::Integer;
+    }
+
+    bool cached(int & v) const
+    {
+        if (m_number != Number::Integer || m_integer < INT_MIN || m_integer > INT_MAX) {
+            return false;
+        }
+        v = static_cast<int>(m_integer);
+        return true;
+    }
+
+    bool cached(double & v) const
+    {
+        v = m_real;
+        return m_number == Number::Real;
+    }
+
+    // the implementation of tryAs() function, it returns false if the
+    // conversion cannot be done
+    template<typename T>
+    bool getValue(std::string_view str, T & v) const
+    {
+        return ValueParser<T>::parse(str, v);
+    }
+
+    /*
+     * Interpret the string as a vector
+     *
+     * The strings added by add() function are stored internaly as "\n"
+     * separated string. Each of them is converted in place.
+     *
+     * In case there is only one string added, the return vector size will be 1.
+     * The elements of a delimited option are converted from list() instead,
+     * and the pairs of a key=value option cannot be converted.
+     *
+     * @tparam T
+     * Template parameter T can be int, long, float, double, std::string or
+     * any other type with a ValueParser
+     *
+     * @return
+     * false if any of the strings cannot be converted
+     */
+    template<typename T>
+    bool getValue(std::string_view str, std::vector<T> & vec) const
+    {
+        if (m_list) {
+            Expected<std::vector<T>> elements = m_list->tryAs<T>();
+            if (elements) {
+                vec = std::move(elements).value();
+            }
+            return static_cast<bool>(elements);
+        }
+        if (m_map) {
+            return false;
+        }
+
+        vec.reserve(m_count);
+        std::size_t pos = 0;
+        while (pos < str.length()) {
+            std::size_t end = std::min(str.find('\n', pos), str.length());
+            T v{};
+            if (!getValue(str.substr(pos, end - pos), v)) {
+                return false;
+            }
+            vec.push_back(std::move(v));
+            pos = end + 1;
+        }
+        return true;
+    }
+};
+
+/**
+ * A prefix tree mapping names to values, used to resolve abbreviated long
+ * options.
+ *
+ * Each node records the value shared by all names below it, so resolving a
+ * prefix costs one walk down the tree, no matter how many names there are.
+ * The children of a node are kept in a sorted sibling list.
+ */
+class PrefixTrie
+{
+public:
+    static const int NOT_FOUND = -1;
+    static const int AMBIGUOUS = -2;
+
+    /**
+     * Add a name
+     *
+     * @param value
+     * a non-negative value for the name. Different names may share a value, a
+     * prefix of such names is not ambiguous.
+     */
+    void insert(const char * name, std::size_t len, int value)
+    {
+        int node = 0;
+        for (std::size_t i = 0; i < len; ++i) {
+            node = addChild(node, name[i]);
+            Node & n = m_nodes[node];
+            if (n.shared == NOT_FOUND) {
+                n.shared = value;
+            }
+            else if (n.shared != value) {
+                n.shared = AMBIGUOUS;
+            }
+        }
+        m_nodes[node].value = value;
+    }
+
+    /**
+     * Look up a name or a prefix of names
+     *
+     * @param exact
+     * true if prefixes are not accepted
+     *
+     * @return
+     * the value of the name, NOT_FOUND or AMBIGUOUS. An exact match wins over
+     * longer names with the same prefix.
+     */
+    int find(const char * name, std::size_t len, bool exact = false) const
+    {
+        if (len == 0) {
+            return NOT_FOUND;
+        }
+
+        int node = 0;
+        for (std::size_t i = 0; i < len && node >= 0; ++i) {
+            node = child(node, name[i]);
+        }
+
+        if (node < 0) {
+            return NOT_FOUND;
+        }
+
+        const Node & n = m_nodes[node];
+        if (n.value >= 0 || exact) {
+            return n.value;
+        }
+        return n.shared;
+    }
+
+    /**
+     * Call f(name, value) for each name starting with the prefix, in
+     * ascending order of names
+     */
+    template<typename F>
+    void forEach(const char * prefix, std::size_t len, F f) const
+    {
+        int node = 0;
+        for (std::size_t i = 0; i < len && node >= 0; ++i) {
+            node = child(node, prefix[i]);
+        }
+
+        if (node >= 0) {
+            std::string name(prefix, len);
+            visit(node, name, f);
+        }
+    }
+
+private:
+    struct Node
+    {
+        char c;
+        int child;      // first child
+        int sibling;    // next sibling, in ascending order of c
+        int value;      // value of the name ending here
+        int shared;     // value of all names below, or AMBIGUOUS
+    };
+
+    // the root is node 0
+    std::vector<Node> m_nodes = { {0, -1, -1, NOT_FOUND, NOT_FOUND} };
+
+    // call f for the names at and below node, name is the name of node
+    template<typename F>
+    void visit(int node, std::string & name, F & f) const
+    {
+        if (m_nodes[node].value >= 0) {
+            f(name, m_nodes[node].value);
+        }
+
+        for (int n = m_nodes[node].child; n >= 0; n = m_nodes[n].sibling) {
+            name += m_nodes[n].c;
+            visit(n, name, f);
+            name.pop_back();
+        }
+    }
+
+    // find the child of node with character c
+    int child(int node, char c) const
+    {
+        int n = m_nodes[node].child;
+        while (n >= 0 && m_nodes[n].c < c) {
+            n = m_nodes[n].sibling;
+        }
+        return (n >= 0 && m_nodes[n].c == c)? n: NOT_FOUND;
+    }
+
+    // find the child of node with character c, add it if not found
+    int addChild(int node, char c)
+    {
+        int * link = &m_nodes[node].child;
+        while (*link >= 0 && m_nodes[*link].c < c) {
+            link = &m_nodes[*link].sibling;
+        }
+
+        if (*link >= 0 && m_nodes[*link].c == c) {
+            return *link;
+        }
+
+        int next = *link;
+        int n = static_cast<int>(m_nodes.size());
+        *link = n; // before push_back, which may move the nodes
+        m_nodes.push_back({c, -1, next, NOT_FOUND, NOT_FOUND});
+        return n;
+    }
+};
+
+/**
+ * An index of names to find the one closest to a misspelled name
+ *
+ * The names are sorted by length and then by name, and a misspelled name is
+ * compared with all names of a length within the edit limit of its own. A
+ * mask of the characters in each name rules out most of them without a
+ * branch, and the distance is computed in a narrow band around the diagonal,
+ * with the rows of a prefix shared with the previous name reused. A search
+ * allocates no memory.
+ *
+ * The names are sorted by the first closest() after they are inserted, so
+ * inserting names in many steps costs no more than inserting them at once.
+ * That closest() must not run in several threads at the same time.
+ */
+class NameIndex
+{
+public:
+    /**
+     * Add a name
+     */
+    void insert(const char * name, std::size_t len, int value)
+    {
+        if (len > 0) {
+            m_entries.push_back({mask(name, len), value});
+            m_names.emplace_back(name, len);
+            m_sorted = false;
+        }
+    }
+
+    /**
+     * Find the name closest to a misspelled name
+     *
+     * The distance is the optimal string alignment distance, i.e. the number
+     * of insertions, deletions, substitutions and transpositions of adjacent
+     * characters. It is limited to 2, or 1 for names of up to 3 characters.
+     *
+     * @return
+     * the closest name, the one with the smallest value in case of a tie, or
+     * an empty string if none is close enough
+     */
+    std::string closest(const char * name, std::size_t len) const
+    {
+        if (len == 0) {
+            return std::string();
+        }
+        if (!m_sorted) {
+            sort();
+        }
+
+        Search search;
+        search.name = name;
+        search.len = len;
+        search.mask = mask(name, len);
+        search.limit = (len <= 3)? 1: 2;
+        search.best = -1;
+        for (int k = 0; k < WIDTH; ++k) {
+            int j = k - BAND;
+            search.rows[0][k] = (j >= 0 && j <= static_cast<int>(len))? j: FAR;
+        }
+
+        // the names of the same length first, a close one found there
+        // narrows the lengths left to search
+        for (std::size_t diff = 0; diff <= static_cast<std::size_t>(search.limit); ++diff) {
+            if (len + diff < m_start.size() - 1) {
+                searchRange(search, m_start[len + diff], m_start[len + diff + 1]);
+            }
+            if (diff > 0 && diff < len && len - diff < m_start.size() - 1) {
+                searchRange(search, m_start[len - diff], m_start[len - diff + 1]);
+            }
+        }
+
+        return (search.best >= 0)? m_names[search.best]: std::string();
+    }
+
+private:
+    // the distances are kept for 2 cells on each side of the diagonal, and
+    // the rows of up to MAX_DEPTH characters are kept for reuse
+    static constexpr int MAX_LIMIT = 2;
+    static constexpr int BAND = MAX_LIMIT + 1;
+    static constexpr int WIDTH = 2 * MAX_LIMIT + 3;
+    static constexpr int FAR = MAX_LIMIT + 1;
+    static constexpr std::size_t MAX_DEPTH = 64;
+    static constexpr int CHUNK = 64;
+
+    struct Entry
+    {
+        std::uint64_t mask;     // the classes of the characters in the name
+        int value;
+    };
+
+    // a name in its sorted position, with what the scan checks kept together
+    struct Slot
+    {
+        std::uint64_t mask;
+        int name;
+        int prefix;             // the length of the prefix shared with the previous
+    };
+
+    // the state of closest()
+    struct Search
+    {
+        const char * name;
+        std::size_t len;
+        std::uint64_t mask;
+        int limit;              // the distance of the best so far
+        int best;
+        int rows[MAX_DEPTH + 1][WIDTH]; // row i has the distances of the
+                                        // first i characters of a name
+    };
+
+    // letters, digits and 4 classes for the other characters
+    static int charClass(char c)
+    {
+        if (c >= 'a' && c <= 'z') {
+            return c - 'a';
+        }
+        if (c >= 'A' && c <= 'Z') {
+            return c - 'A';
+        }
+        if (c >= '0' && c <= '9') {
+            return 26 + (c - '0');
+        }
+        return 36 + static_cast<unsigned char>(c) % 4;
+    }
+
+    static int bitCount(std::uint64_t x)
+    {
+#if defined(__POPCNT__)
+        return __builtin_popcountll(x);
+#else
+        x = x - ((x >> 1) & 0x5555555555555555ull);
+        x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+        x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+        return static_cast<int>((x * 0x0101010101010101ull) >> 56);
+#endif
+    }
+
+    static std::uint64_t mask(const char * name, std::size_t len)
+    {
+        std::uint64_t bits = 0;
+        for (std::size_t i = 0; i < len; ++i) {
+            bits |= std::uint64_t(1) << charClass(name[i]);
+        }
+        return bits;
+    }
+
+    void sort() const
+    {
+        std::size_t maxLen = 0;
+        for (auto & name : m_names) {
+            maxLen = std::max(maxLen, name.length());
+        }
+
+        std::size_t n = m_names.size();
+        std::vector<int> names(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            names[i] = static_cast<int>(i);
+        }
+        std::sort(names.begin(), names.end(), [&](int a, int b) {
+            const std::string & x = m_names[a];
+            const std::string & y = m_names[b];
+            return (x.length() != y.length())? x.length() < y.length(): x < y;
+        });
+
+        m_start.assign(maxLen + 2, 0);
+        m_slots.resize(n);
+        for (std::size_t p = 0; p < n; ++p) {
+            const std::string & name = m_names[names[p]];
+            ++m_start[name.length() + 1];
+
+            // the rows kept for reuse stop at MAX_DEPTH anyway
+            std::size_t shared = 0;
+            if (p > 0) {
+                const std::string & prev = m_names[names[p - 1]];
+                while (shared < name.length() && shared < prev.length() &&
+                        shared <= MAX_DEPTH && name[shared] == prev[shared]) {
+                    ++shared;
+                }
+            }
+            m_slots[p] = {m_entries[names[p]].mask, names[p], static_cast<int>(shared)};
+        }
+        for (std::size_t i = 1; i < m_start.size(); ++i) {
+            m_start[i] += m_start[i - 1];
+        }
+        m_sorted = true;
+    }
+
+    // search the names in m_slots[begin, end), all of the same length
+    void searchRange(Search & search, int begin, int end) const
+    {
+        std::size_t valid = 0;      // the rows kept from the previous name
+        std::size_t failed = MAX_DEPTH + 1; // the row it went over the limit
+        int hits[CHUNK];
+        std::size_t shares[CHUNK];  // the prefix shared with the previous hit
+        std::size_t run = 0;
+        for (int chunk = begin; chunk < end; chunk += CHUNK) {
+            int last = std::min(end, chunk + CHUNK);
+
+            // an edit adds or removes at most two characters, so at most
+            // 2 * limit classes differ; most names fail, so they are
+            // filtered without branches
+            int count = 0;
+            for (int p = chunk; p < last; ++p) {
+                const Slot & slot = m_slots[p];
+                run = std::min<std::size_t>(run, slot.prefix);
+                hits[count] = p;
+                shares[count] = run;
+                bool hit = bitCount(slot.mask ^ search.mask) <= 2 * search.limit;
+                count += hit;
+                run = hit? MAX_DEPTH + 1: run;
+            }
+
+            for (int h = 0; h < count; ++h) {
+                std::size_t shared = shares[h];
+                valid = std::min(valid, shared);
+                if (shared >= failed) {
+                    continue;   // it goes over the limit in the same row
+                }
+                failed = MAX_DEPTH + 1;
+
+                int n = m_slots[hits[h]].name;
+                const std::string & name = m_names[n];
+                int d = FAR;
+                if (name.length() > MAX_DEPTH) {
+                    d = distance(search, name);
+                }
+                else {
+                    std::size_t i = valid + 1;
+                    for (; i <= name.length(); ++i) {
+                        if (row(search, name, i, search.rows[i], search.rows[i - 1],
+                                search.rows[i - 2 + (i < 2)]) > search.limit) {
+                            break;
+                        }
+                    }
+                    if (i <= name.length()) {
+                        valid = failed = i;
+                        continue;
+                    }
+                    valid = name.length();
+                    d = search.rows[valid][search.len + BAND - valid];
+                }
+
+                if (d < search.limit || (d == search.limit &&
+                        (search.best < 0 || m_entries[n].value < m_entries[search.best].value))) {
+                    search.limit = d;
+                    search.best = n;
+                }
+            }
+        }
+    }
+
+    // compute row i of the distances from the previous two, and return its
+    // smallest distance
+    static int row(const Search & search, const std::string & name, std::size_t i,
+            int * cur, const int * prev, const int * prev2)
+    {
+        const char * q = search.name;
+        cur[0] = cur[WIDTH - 1] = FAR;
+        int rowMin = FAR;
+        for (int k = 1; k < WIDTH - 1; ++k) {
+            std::ptrdiff_t j = static_cast<std::ptrdiff_t>(i) + k - BAND;
+            int d = FAR;
+            if (j == 0) {
+                d = std::min(static_cast<int>(i), FAR);
+            }
+            else if (j > 0 && j <= static_cast<std::ptrdiff_t>(search.len)) {
+                d = prev[k] + ((name[i - 1] == q[j - 1])? 0: 1);
+                d = std::min(d, prev[k + 1] + 1);
+                d = std::min(d, cur[k - 1] + 1);
+                if (i > 1 && j > 1 && name[i - 1] == q[j - 2] && name[i - 2] == q[j - 1]) {
+                    d = std::min(d, prev2[k] + 1);
+                }
+                d = std::min(d, FAR);
+            }
+            cur[k] = d;
+            rowMin = std::min(rowMin, d);
+        }
+        return rowMin;
+    }
+
+    // the distance to a name too long to keep its rows, with three rows
+    // taking turns
+    static int distance(const Search & search, const std::string & name)
+    {
+        int rows[3][WIDTH];
+        std::copy(search.rows[0], search.rows[0] + WIDTH, rows[0]);
+        for (std::size_t i = 1; i <= name.length(); ++i) {
+            if (row(search, name, i, rows[i % 3], rows[(i - 1) % 3], rows[(i + 1) % 3]) > search.limit) {
+                return FAR;
+            }
+        }
+        return rows[name.length() % 3][search.len + BAND - name.length()];
+    }
+
+    std::vector<Entry> m_entries;
+    std::vector<std::string> m_names;
+
+    // sorted by closest() when names were inserted since
+    mutable bool m_sorted = true;
+    mutable std::vector<Slot> m_slots;  // names sorted by length and name
+    mutable std::vector<int> m_start = {0}; // first position by length
+};
+
+/**
+ * A fixed set of words mapped to their positions, e.g. the choices "fast",
+ * "safe" and "debug" to 0, 1 and 2.
+ *
+ * The words are placed with a perfect hash: the seed and the table size are
+ * searched once until no two words share a slot, so a lookup hashes the word
+ * once and compares it with at most one candidate. The table is kept within
+ * four times the number of words, and if no seed places them all, which is
+ * likely for long lists, the words are searched in sorted order instead.
+ */
+class ChoiceSet
+{
+public:
+    /**
+     * Build the set from a list such as "{fast,safe,debug}"
+     *
+     * @return
+     * false if the list is empty, has an empty word or a duplicate
+     */
+    bool build(const std::string & list)
+    {
+        m_words.clear();
+        if (list.length() < 3 || list.front() != '{' || list.back() != '}') {
+            return false;
+        }
+
+        std::size_t pos = 1;
+        while (pos < list.length()) {
+            std::size_t end = list.find_first_of(",}", pos);
+            if (end == pos || (list[end] == '}' && end + 1 != list.length())) {
+                return false;
+            }
+            m_words.push_back(list.substr(pos, end - pos));
+            pos = end + 1;
+        }
+
+        m_sorted.resize(m_words.size());
+        for (std::size_t i = 0; i < m_sorted.size(); ++i) {
+            m_sorted[i] = static_cast<int>(i);
+        }
+        std::sort(m_sorted.begin(), m_sorted.end(), [this](int a, int b) {
+            return m_words[a] < m_words[b];
+        });
+        for (std::size_t i = 1; i < m_sorted.size(); ++i) {
+            if (m_words[m_sorted[i - 1]] == m_words[m_sorted[i]]) {
+                m_words.clear();
+                return false;
+            }
+        }
+
+        std::size_t size = 1;
+        while (size < m_words.size() * 2) {
+            size *= 2;
+        }
+
+        for (std::size_t limit = size * 2; size <= limit; size *= 2) {
+            for (m_seed = 0; m_seed < 64; ++m_seed) {
+                if (place(size)) {
+                    return true;
+                }
+            }
+        }
+
+        m_table.clear();    // find() searches m_sorted instead
+        return true;
+    }
+
+    /**
+     * Check if the set has any words
+     */
+    bool empty() const
+    {
+        return m_words.empty();
+    }
+
+    /**
+     * Find a word
+     *
+     * @return
+     * the position of the word in the list, or -1 if it is not in the set
+     */
+    int find(const char * word, std::size_t len) const
+    {
+        if (!m_table.empty()) {
+            int i = m_table[hash(word, len) & m_mask];
+            if (i >= 0 && m_words[i].length() == len &&
+                    std::memcmp(m_words[i].data(), word, len) == 0) {
+                return i;
+            }
+            return -1;
+        }
+
+        std::string_view key(word, len);
+        auto it = std::lower_bound(m_sorted.begin(), m_sorted.end(), key,
+                [this](int i, std::string_view k) {
+            return std::string_view(m_words[i]) < k;
+        });
+        return (it != m_sorted.end() && m_words[*it] == key)? *it: -1;
+    }
+
+    /**
+     * Get the words in their original order
+     */
+    const std::vector<std::string> & words() const
+    {
+        return m_words;
+    }
+
+private:
+    // FNV-1a with a seed
+    std::uint32_t hash(const char * word, std::size_t len) const
+    {
+        std::uint32_t h = 2166136261u ^ (m_seed * 0x9e3779b9u);
+        for (std::size_t i = 0; i < len; ++i) {
+            h ^= static_cast<unsigned char>(word[i]);
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    // try to place the words in a table of the given size with the seed
+    bool place(std::size_t size)
+    {
+        m_mask = static_cast<std::uint32_t>(size - 1);
+        m_table.assign(size, -1);
+        for (std::size_t i = 0; i < m_words.size(); ++i) {
+            int & slot = m_table[hash(m_words[i].data(), m_words[i].length()) & m_mask];
+            if (slot >= 0) {
+                return false;
+            }
+            slot = static_cast<int>(i);
+        }
+        return true;
+    }
+
+    std::vector<std::string> m_words;
+    std::vector<int> m_sorted;  // positions in the order of the words
+    std::vector<int> m_table;   // slot to position, -1 if empty, or none
+    std::uint32_t m_seed = 0;
+    std::uint32_t m_mask = 0;
+};
+
+/**
+ * A type and range an option argument must satisfy, e.g. "int[1,256]" or
+ * "double(0,1]"
+ *
+ * The type is one of int, long and double. The range is optional, a bound
+ * left empty is unlimited, e.g. "long[0,]". A square bracket includes the
+ * bound and a parenthesis excludes it.
+ */
+class Constraint
+{
+public:
+    /**
+     * Compile a constraint from its text
+     *
+     * @return
+     * false if the text is not a valid constraint
+     */
+    bool compile(const std::string & spec)
+    {
+        static const char * const types[] = {"int", "long", "double"};
+
+        m_type = NONE;
+        std::size_t pos = 0;
+        for (int t = INT; t <= DOUBLE; ++t) {
+            std::size_t len = std::strlen(types[t - 1]);
+            if (spec.compare(0, len, types[t - 1]) == 0) {
+                m_type = t;
+                pos = len;
+                break;
+            }
+        }
+        if (m_type == NONE) {
+            return false;
+        }
+
+        m_spec = spec;
+        m_hasMin = m_hasMax = false;
+        if (pos == spec.length()) {
+            return true;
+        }
+
+        // e.g. "[1,256]"
+        std::size_t comma = spec.find(',', pos);
+        char open = spec[pos];
+        char close = spec.back();
+        if ((open != '[' && open != '(') || (close != ']' && close != ')') ||
+                comma == std::string::npos) {
+            m_type = NONE;
+            return false;
+        }
+        m_minOpen = (open == '(');
+        m_maxOpen = (close == ')');
+
+        std::string lo = spec.substr(pos + 1, comma - pos - 1);
+        std::string hi = spec.substr(comma + 1, spec.length() - comma - 2);
+        m_hasMin = !lo.empty();
+        m_hasMax = !hi.empty();
+        bool ok = (m_type == DOUBLE)?
+                (!m_hasMin || fromChars(lo, m_min)) &&
+                (!m_hasMax || fromChars(hi, m_max)):
+                (!m_hasMin || toLong(lo, m_minInt)) &&
+                (!m_hasMax || toLong(hi, m_maxInt));
+        if (!ok) {
+            m_type = NONE;
+        }
+        return ok;
+    }
+
+    /**
+     * Check if there is no constraint
+     */
+    bool empty() const
+    {
+        return m_type == NONE;
+    }
+
+    /**
+     * Check a value, the number it is converted to is kept in value
+     *
+     * @return
+     * false if the value is not of the type or out of the range
+     */
+    bool check(const char * arg, StringValue & value) const
+    {
+        if (m_type == DOUBLE) {
+            double v;
+            if (!fromChars(arg, v) || !inRange(v, m_min, m_max)) {
+                return false;
+            }
+            value.setNumber(v);
+        }
+        else {
+            long v;
+            if (!toLong(arg, v) || !inRange(v, m_minInt, m_maxInt)) {
+                return false;
+            }
+            value.setNumber(v);
+        }
+        return true;
+    }
+
+    /**
+     * Get the text of the constraint
+     */
+    const std::string & spec() const
+    {
+        return m_spec;
+    }
+
+private:
+    enum {NONE, INT, LONG, DOUBLE};
+
+    template<typename T>
+    bool inRange(T v, T min, T max) const
+    {
+        return (!m_hasMin || min < v || (!m_minOpen && v == min)) &&
+                (!m_hasMax || v < max || (!m_maxOpen && v == max));
+    }
+
+    // the rules of fromChars() as for the values, int must fit in int
+    bool toLong(std::string_view str, long & v) const
+    {
+        return fromChars(str, v) && (m_type != INT || (v >= INT_MIN && v <= INT_MAX));
+    }
+
+    int m_type = NONE;
+    std::string m_spec;
+    bool m_hasMin = false;
+    bool m_hasMax = false;
+    bool m_minOpen = false;     // true if the minimum is excluded
+    bool m_maxOpen = false;
+    long m_minInt = 0;          // the bounds of int and long
+    long m_maxInt = 0;
+    double m_min = 0;           // the bounds of double
+    double m_max = 0;
+};
+
+/**
+ * The engines CmdOption::parse() can use
+ */
+enum class ParseEngine
+{
+    Native,     // the built-in parser
+    Getopt      // getopt_long()
+};
+
+/**
+ * The shells CmdOption::completionScript() supports
+ */
+enum class Shell
+{
+    Bash,
+    Zsh,
+    Fish
+};
+
+/**
+ * This class represents command line options
+ *
+ * The major difference from other existing solutions is that this class do not
+ * require manually adding option definitions. Instead, it adds those definition
+ * by parsing usage text.
+ *
+ * Another minor difference is that accessing parsed options can be done with
+ * implicit conversion along with explicit means. Those conversions are done
+ * with the class StringValue. See above for more information.
+ */
+class CmdOption
+{
+
+public:
+    /**
+     * default constructor
+     */
+    CmdOption()
+    {
+        for (auto & opt : m_shortOptions) {
+            opt = {-1, no_argument};
+        }
+        CMDOPTION_STAT(m_arguments.setStats(m_stats));
+    }
+
+    /**
+     * Initialize the options with usage text
+     *
+     * @param usage
+     * The usage text following the linux system manual page style. For example:
+     *
+     *
+     * -a, --all show all elements, no arguments required
+     * -b, --batch  this option is separated by more than one space
+     * -c  no long option and no argument required
+     * -d --delta=NUM set delta number, need argument
+     * -e --epsilon[=NUM] requires optional argument
+     *     with or without comma ',' after short option are OK
+     *     the lines not started with '-' will be ignored
+     *
+     * -f FILE
+     *     delete a file, no long option, need argument; in this case,
+     *     explanation must be in separate line
+     *
+     * An option may have several spellings, and a switch may be negated:
+     *
+     * -o, --out, --output=FILE  all spellings are the same option
+     * --[no-]color  "--color" and "--no-color", see StringValue::flagOr()
+     *
+     * The relations between options are declared with lines such as:
+     *
+     * Required: --input
+     * Exclusive: --fast --safe
+     * Requires: --output --format
+     *
+     * i.e. --input must be given, at most one of --fast and --safe may be
+     * given, and --output needs --format. They are checked after parse().
+     */
+    void operator<<(const std::string & usage)
+    {
+        CMDOPTION_STAT(StatTimer timer(m_stats->initNs));
+        m_usage = usage;
+        m_helpCache.clear();
+        init(usage);
+    }
+
+    /**
+     * Add options from another block of usage text
+     *
+     * Only the new text is parsed, so loading many fragments, for example one
+     * for each plugin, costs in proportion to what is loaded. The options are
+     * checked for duplicates against all options known so far. The values of
+     * an earlier parse are kept, as are the references to them.
+     *
+     * @param usage
+     * the usage text to append, see operator<<
+     */
+    void append(const std::string & usage)
+    {
+        CMDOPTION_STAT(StatTimer timer(m_stats->initNs));
+        if (!m_usage.empty() && m_usage.back() != '\n') {
+            m_usage += '\n';
+        }
+        m_usage += usage;
+        m_helpCache.clear();
+        init(usage);
+    }
+
+    /**
+     * Show usage
+     *
+     * @param os
+     * output stream, default is std::cout
+     */
+    void usage(std::ostream& os = std::cout)
+    {
+        os << m_usage << std::endl;
+    }
+
+    /**
+     * Get the usage text formatted for a given width
+     *
+     * The descriptions on the option lines are aligned in one column, and
+     * lines longer than the width are wrapped at word boundaries, keeping
+     * their indentation. The result is cached per width, so only the first
+     * call for a width does any work.
+     *
+     * @param width
+     * the width in characters, 0 for the width of the terminal
+     */
+    const std::string & help(int width = 0)
+    {
+        if (width <= 0) {
+            width = terminalWidth();
+        }
+
+        auto it = m_helpCache.find(width);
+        if (it != m_helpCache.end()) {
+            CMDOPTION_STAT(++m_stats->cacheHits);
+            return it->second;
+        }
+
+        return m_helpCache[width] = renderHelp(width);
+    }
+
+    /**
+     * Write the formatted usage text, see help()
+     *
+     * The text is written with a single write() system call (more only if the
+     * output takes it partially), bypassing the stream buffers.
+     *
+     * @param fd
+     * the file descriptor to write to, default is the standard output
+     *
+     * @param width
+     * the width in characters, 0 for the width of the terminal
+     *
+     * @return
+     * true if the whole text was written
+     */
+    bool printHelp(int fd = STDOUT_FILENO, int width = 0)
+    {
+        const std::string & text = help((width > 0)? width: terminalWidth(fd));
+        const char * p = text.data();
+        std::size_t left = text.size();
+        while (left > 0) {
+            ssize_t n = ::write(fd, p, left);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            p += n;
+            left -= n;
+        }
+        return true;
+    }
+
+    /**
+     * Check the status of the object
+     *
+     * @return
+     * true if no error encountered
+     */
+    bool good()
+    {
+        return m_errorStr.empty();
+    }
+
+    /**
+     * Parse the command line
+     *
+     * The command line follows the getopt_long() conventions: non-option
+     * arguments may be mixed with options, "--" ends the options, optional
+     * arguments are given only with "--opt=value" or "-ovalue", and long
+     * options may be abbreviated to any unambiguous prefix (see
+     * setExactMatch()). Unlike getopt_long(), argv is left untouched.
+     *
+     * @param argc
+     * @param argv
+     * The parameters passed to main()
+     */
+    void parse(int argc, char** argv)
+    {
+#ifdef CMDOPTION_STATS
+        {
+            StatTimer timer(m_stats->parseNs);
+            parseArgs(argc, argv);
+            assignPositionals();
+            checkRules();
+        }
+        if (m_statsCallback) {
+            m_statsCallback(*m_stats);
+        }
+#else
+        parseArgs(argc, argv);
+        assignPositionals();
+        checkRules();
+#endif
+    }
+
+#ifdef CMDOPTION_STATS
+    /**
+     * Get the statistics of the object, available with CMDOPTION_STATS
+     *
+     * The conversion figures include the values of options accessed through
+     * operator[], the arguments are not included.
+     */
+    const ParseStats & stats() const
+    {
+        return *m_stats;
+    }
+
+    /**
+     * Set a function called with the statistics at the end of every parse(),
+     * available with CMDOPTION_STATS
+     */
+    void setStatsCallback(std::function<void(const ParseStats &)> callback)
+    {
+        m_statsCallback = callback;
+    }
+#endif
+
+    /**
+     * Clear the results of parsing
+     *
+     * The options from the usage text are kept, so the object can parse
+     * another command line. The storage of the results is kept as well, so
+     * that an object reused for many command lines of similar size stops
+     * allocating memory after the first ones.
+     */
+    void reset()
+    {
+        for (auto & sv : m_options) {
+            sv.clear();
+        }
+        m_arguments.clear();
+        m_argList.clear();
+        for (auto & pos : m_positionals) {
+            pos.value.clear();
+        }
+        m_errorStr.resize(m_usageErrorSize);
+        m_forwarded.clear();
+        m_records.clear();
+
+        for (auto & item : m_subcommands) {
+            if (item.second.option) {
+                item.second.option->reset();
+            }
+        }
+        m_subcommand.clear();
+    }
+
+    /**
+     * Require long options to be spelled out in full
+     *
+     * By default a long option may be abbreviated to any unambiguous prefix,
+     * e.g. "--prec=3" for "--precision=3". Scripts that must not depend on
+     * abbreviations can turn this off.
+     *
+     * @param exact
+     * true to accept exact long option names only
+     */
+    void setExactMatch(bool exact)
+    {
+        m_exactMatch = exact;
+    }
+
+    /**
+     * Stop parsing options at the first non-option argument
+     *
+     * By default options and non-option arguments may be mixed, e.g.
+     * "prog a -v b". In this mode "-v" is taken as an argument, as is
+     * everything after "a". It is also turned on by the environment variable
+     * POSIXLY_CORRECT, as getopt_long() does.
+     *
+     * Wrappers that forward the rest of the command line to another program
+     * want this: the options of the other program are left alone and argv is
+     * taken in a single pass without being reordered.
+     *
+     * @param requireOrder
+     * true to stop at the first non-option argument
+     */
+    void setRequireOrder(bool requireOrder)
+    {
+        m_requireOrder = requireOrder;
+    }
+
+    /**
+     * Check the arguments against the "Usage:" line, see positional()
+     *
+     * By default the arguments are only given to the names of the "Usage:"
+     * line, as many programs print a line that is not meant to be enforced,
+     * e.g. "prog --help" with the arguments left out. When checking, missing,
+     * unexpected and invalid arguments are reported as errors, and an invalid
+     * one is not stored, as with options.
+     *
+     * @param checkArguments
+     * true to report the arguments that do not match the "Usage:" line
+     */
+    void setCheckArguments(bool checkArguments)
+    {
+        m_checkArguments = checkArguments;
+    }
+
+    /**
+     * Collect unknown options instead of reporting them as errors
+     *
+     * Wrappers can take their own options and pass all the rest to another
+     * program. The unknown options and the non-option arguments are collected
+     * in their original order, see forwarded(). An element of bundled short
+     * options is forwarded as a whole if its first option is unknown; an
+     * unknown option after a known one in the same element is still an
+     * error. Only the native engine supports this mode, parse() reports an
+     * error with ParseEngine::Getopt.
+     *
+     * @param passThrough
+     * true to collect unknown options
+     */
+    void setPassThrough(bool passThrough)
+    {
+        m_passThrough = passThrough;
+    }
+
+    /**
+     * Get the command line to forward in pass-through mode
+     *
+     * The elements are the original argv pointers, nothing is copied. It
+     * starts with argv[0] and ends with nullptr, so it can be handed to
+     * execv() once the first element is replaced with the program to run:
+     *
+     * auto & args = command_opt.forwarded();
+     * args[0] = const_cast<char *>("/usr/bin/child");
+     * execv(args[0], args.data());
+     *
+     * @return
+     * the command line of the last parse(), empty if not in pass-through
+     * mode
+     */
+    std::vector<char *> & forwarded()
+    {
+        return m_forwarded;
+    }
+
+    /**
+     * Keep what each argv element was parsed into, so that an edited command
+     * line can be parsed again with reparse()
+     *
+     * In this mode every parse() replaces the results of the previous one
+     * instead of adding to them. It is not supported with subcommands or the
+     * getopt_long() engine.
+     *
+     * @param incremental
+     * true to turn the mode on
+     */
+    void setIncremental(bool incremental)
+    {
+        m_incremental = incremental;
+    }
+
+    /**
+     * Parse the command line after an edit of the one parsed last
+     *
+     * Only the elements around the edit are scanned, the rest of the results
+     * of the last parse are taken over. This keeps interactive tools such as
+     * shells responsive while the command line is being typed. Requires
+     * setIncremental(true), otherwise the command line is parsed afresh.
+     *
+     * @param argc
+     * @param argv
+     * The edited command line
+     *
+     * @param first
+     * the first argv element that was replaced
+     *
+     * @param removed
+     * number of elements replaced in the last command line
+     *
+     * @param inserted
+     * number of elements in their place in argv
+     */
+    void reparse(int argc, char** argv, int first, int removed, int inserted)
+    {
+        if (!incremental() || m_records.empty() || first < 1) {
+            reset();
+            parse(argc, argv);
+            return;
+        }
+
+#ifdef CMDOPTION_STATS
+        {
+            StatTimer timer(m_stats->parseNs);
+            rescan(argc, argv, first, removed, inserted);
+        }
+        if (m_statsCallback) {
+            m_statsCallback(*m_stats);
+        }
+#else
+        rescan(argc, argv, first, removed, inserted);
+#endif
+    }
+
+    /**
+     * Select the engine used by parse()
+     *
+     * ParseEngine::Native is the default. ParseEngine::Getopt parses with
+     * getopt_long() as earlier versions did; it permutes argv and always
+     * accepts abbreviated long options. It is kept for comparison.
+     *
+     * Both engines give the same options and arguments, only the error
+     * messages differ.
+     */
+    void setParseEngine(ParseEngine engine)
+    {
+        m_engine = engine;
+    }
+
+    /**
+     * Generate a shell completion script
+     *
+     * The option names and the subcommands are written into the script, so
+     * completion does not need to run the program. The argument of an option
+     * is completed as a file name if its placeholder in the usage text
+     * contains "FILE" or "PATH", and as a directory if it contains "DIR".
+     *
+     * The script is typically written out by a hidden option of the program
+     * and sourced from the shell's startup file.
+     *
+     * @param shell
+     * the target shell
+     *
+     * @param program
+     * the name of the program as typed on the command line
+     */
+    std::string completionScript(Shell shell, const std::string & program) const
+    {
+        std::string func = "_";
+        for (char c : program) {
+            func += std::isalnum(static_cast<unsigned char>(c))? c: '_';
+        }
+        func += "_complete";
+
+        std::vector<std::vector<std::string>> names = optionNames();
+        std::string words;
+        for (auto & spellings : names) {
+            for (auto & name : spellings) {
+                words += (words.empty()? "": " ") + name;
+            }
+        }
+        std::string commands;
+        for (auto & cmd : subcommandNames()) {
+            commands += (commands.empty()? "": " ") + cmd;
+        }
+
+        std::ostringstream os;
+        if (shell == Shell::Bash) {
+            os << func << "() {\n"
+               << "    local cur=\"${COMP_WORDS[COMP_CWORD]}\"\n"
+               << "    local prev=\"${COMP_WORDS[COMP_CWORD-1]}\"\n"
+               << "    case \"$prev\" in\n";
+            for (std::size_t i = 0; i < names.size(); ++i) {
+                if (m_argReqmts[i] != required_argument || names[i].empty()) {
+                    continue;
+                }
+
+                os << "    ";
+                for (std::size_t k = 0; k < names[i].size(); ++k) {
+                    os << (k > 0? "|": "") << names[i][k];
+                }
+                const char * kind = argKind(m_argNames[i]);
+                if (!m_choices[i].empty()) {
+                    os << ") COMPREPLY=( $(compgen -W \"" << choiceWords(i) << "\" -- \"$cur\") ); return;;\n";
+                }
+                else if (kind[0] == 0) {
+                    os << ") return;;\n";
+                }
+                else {
+                    os << ") COMPREPLY=( $(compgen -" << kind << " -- \"$cur\") ); return;;\n";
+                }
+            }
+            os << "    esac\n"
+               << "    if [[ \"$cur\" == -* ]]; then\n"
+               << "        COMPREPLY=( $(compgen -W \"" << words << "\" -- \"$cur\") )\n";
+            if (!commands.empty()) {
+                os << "    else\n"
+                   << "        COMPREPLY=( $(compgen -W \"" << commands << "\" -- \"$cur\") )\n";
+            }
+            else {
+                os << "    else\n"
+                   << "        COMPREPLY=( $(compgen -f -- \"$cur\") )\n";
+            }
+            os << "    fi\n"
+               << "}\n"
+               << "complete -F " << func << " " << program << "\n";
+        }
+        else if (shell == Shell::Zsh) {
+            os << "#compdef " << program << "\n"
+               << "_arguments -s";
+            for (std::size_t i = 0; i < names.size(); ++i) {
+                std::string action;
+                const char * kind = argKind(m_argNames[i]);
+                if (!m_choices[i].empty()) {
+                    action = "(" + choiceWords(i) + ")";
+                }
+                else if (kind[0] == 'f') {
+                    action = "_files";
+                }
+                else if (kind[0] == 'd') {
+                    action = "_files -/";
+                }
+
+                // a ':' in the message would end it early, and the spec is
+                // quoted with "'"
+                std::string arg = ":";
+                for (char c : m_argNames[i]) {
+                    if (c == ':') {
+                        arg += "\\:";
+                    }
+                    else if (c == '\'') {
+                        arg += "'\\''";
+                    }
+                    else {
+                        arg += c;
+                    }
+                }
+                arg += ":" + action;
+
+                for (auto & name : names[i]) {
+                    os << " \\\n    '" << name;
+                    bool isLong = (name[1] == '-');
+                    if (m_argReqmts[i] == required_argument) {
+                        os << (isLong? "=": "+") << arg;
+                    }
+                    else if (m_argReqmts[i] == optional_argument) {
+                        os << (isLong? "=-": "-") << arg;
+                    }
+                    os << "'";
+                }
+            }
+            if (!commands.empty()) {
+                os << " \\\n    '1:command:(" << commands << ")'"
+                   << " \\\n    '*::argument:_files'";
+            }
+            else {
+                os << " \\\n    '*:argument:_files'";
+            }
+            os << "\n";
+        }
+        else {
+            for (std::size_t i = 0; i < names.size(); ++i) {
+                if (names[i].empty()) {
+                    continue;
+                }
+
+                os << "complete -c " << program;
+                for (auto & name : names[i]) {
+                    os << ((name[1] == '-')? " -l ": " -s ") << name.substr((name[1] == '-')? 2: 1);
+                }
+                if (m_argReqmts[i] == required_argument) {
+                    const char * kind = argKind(m_argNames[i]);
+                    if (!m_choices[i].empty()) {
+                        os << " -r -f -a '" << choiceWords(i) << "'";
+                    }
+                    else {
+                        os << ((kind[0] == 0)? " -r -f": " -r -F");
+                    }
+                }
+                os << "\n";
+            }
+            if (!commands.empty()) {
+                os << "complete -c " << program << " -n __fish_use_subcommand -f -a '"
+                   << commands << "'\n";
+            }
+        }
+
+        return os.str();
+    }
+
+    /**
+     * Get the choices of the option with given index, separated by spaces
+     */
+    std::string choiceWords(std::size_t i) const
+    {
+        std::string words;
+        for (auto & word : m_choices[i].words()) {
+            words += (words.empty()? "": " ") + word;
+        }
+        return words;
+    }
+
+    /**
+     * Answer a completion query, without doing anything else
+     *
+     * Call it at the very beginning of main(). If the program is run as
+     * "prog --__complete WORD", the options and subcommands starting with WORD
+     * are written one per line, and true is returned so that the program can
+     * exit right away:
+     *
+     * if (tianbo::CmdOption::complete(argc, argv, usageText)) {
+     *     return 0;
+     * }
+     *
+     * Only the usage text and the subcommand names are read to answer it,
+     * the long option names are taken in sorted order from the prefix tree.
+     *
+     * @param subcommands
+     * the names of the subcommands, as given to addSubcommand()
+     *
+     * @return
+     * true if it was a completion query
+     */
+    static bool complete(int argc, char** argv, const std::string & usage,
+            const std::vector<std::string> & subcommands, std::ostream & os = std::cout)
+    {
+        if (argc < 2 || std::strcmp(argv[1], "--__complete") != 0) {
+            return false;
+        }
+
+        CmdOption opt;
+        opt << usage;
+        for (auto & name : subcommands) {
+            opt.addSubcommand(name, std::string());
+        }
+        opt.completions((argc > 2)? argv[2]: "", os);
+        return true;
+    }
+
+    /**
+     * Answer a completion query of a program without subcommands
+     */
+    static bool complete(int argc, char** argv, const std::string & usage,
+            std::ostream & os = std::cout)
+    {
+        return complete(argc, argv, usage, std::vector<std::string>(), os);
+    }
+
+    /**
+     * Write the options and subcommands starting with the word, one per line
+     *
+     * @param word
+     * the word being completed
+     */
+    void completions(const std::string & word, std::ostream & os = std::cout) const
+    {
+        if (word.empty() || word[0] != '-') {
+            for (auto & cmd : subcommandNames()) {
+                if (cmd.compare(0, word.length(), word) == 0) {
+                    os << cmd << "\n";
+                }
+            }
+            return;
+        }
+
+        if (word.length() <= 2 && word[1] != '-') {
+            for (int c = 0; c < 256; ++c) {
+                if (m_shortOptions[c].index >= 0 &&
+                        (word.length() == 1 || word[1] == static_cast<char>(c))) {
+                    os << '-' << static_cast<char>(c) << "\n";
+                }
+            }
+        }
+
+        if (word.length() == 1 || word[1] == '-') {
+            std::size_t skip = (word.length() == 1)? 1: 2;
+            m_longTrie.forEach(word.data() + skip, word.length() - skip,
+                    [&os](const std::string & name, int) {
+                os << "--" << name << "\n";
+            });
+        }
+    }
+
+    /**
+     * Declare a subcommand
+     *
+     * Once a subcommand is declared, option parsing stops at the first
+     * non-option argument, which is taken as the subcommand name. The
+     * subcommand then parses the rest of the command line with its own
+     * options. For example, "tool -v build -j 4" gives "-v" to the tool and
+     * "-j 4" to the subcommand "build".
+     *
+     * The subcommand is parsed with the settings of the tool: the engine,
+     * exact match, require order, pass-through and argument checking. In
+     * pass-through mode the subcommand name and what the subcommand forwards
+     * are added to forwarded().
+     *
+     * The usage text of the subcommand is only stored here. It is parsed when
+     * the subcommand is selected on the command line, so declaring many large
+     * subcommands costs next to nothing at startup.
+     *
+     * @param name
+     * the name of the subcommand
+     *
+     * @param usage
+     * the usage text of the subcommand, see operator<<
+     */
+    void addSubcommand(const std::string & name, const std::string & usage)
+    {
+        if (m_subcommands.find(name) != m_subcommands.end()) {
+            addErrorStr("duplicate subcommand: " + name);
+            m_usageErrorSize = m_errorStr.size();
+            return;
+        }
+        m_subcommands[name].usage = usage;
+
+        // '+' makes getopt_long() stop at the first non-option argument
+        if (m_shortOptStr[0] != '+') {
+            m_shortOptStr.insert(0, "+");
+        }
+    }
+
+    /**
+     * Get the name of the selected subcommand
+     *
+     * @return
+     * the name of the subcommand, or an empty string if none was selected
+     */
+    const std::string & subcommand() const
+    {
+        return m_subcommand;
+    }
+
+    /**
+     * Access the selected subcommand
+     *
+     * @return
+     * The options of the selected subcommand, or nullptr if none was selected
+     */
+    CmdOption * subcommandOption()
+    {
+        if (m_subcommand.empty()) {
+            return nullptr;
+        }
+        return m_subcommands[m_subcommand].option.get();
+    }
+
+    /**
+     * Access an option
+     *
+     * @param opt
+     * short or long option name
+     *
+     * @return
+     * A StringValue object that can be converted to various types
+     *
+     * @throw
+     * std::invalid_argument if the option is not in the usage text. Without
+     * exceptions the program is aborted instead, use tryGet() to handle the
+     * error.
+     */
+    StringValue& operator[](const std::string & opt)
+    {
+        auto sv = tryGet(opt);
+        if (!sv) {
+            CMDOPTION_THROW(std::invalid_argument("unknown option: " + opt));
+        }
+        return *sv.value();
+    }
+
+    /**
+     * Access an option without throwing
+     *
+     * @param opt
+     * short or long option name
+     *
+     * @return
+     * A pointer to the StringValue object of the option, or an error if the
+     * option is not in the usage text.
+     */
+    Expected<StringValue*> tryGet(const std::string & opt)
+    {
+        auto it = m_indexMap.find(opt);
+        if (it == m_indexMap.end()) {
+            return Expected<StringValue*>::failure("unknown option");
+        }
+
+        return &m_options[it->second];
+    }
+
+    /**
+     * Suggest the long option closest to a misspelled one
+     *
+     * parse() adds the suggestion to the error of an unknown long option.
+     *
+     * @param name
+     * the misspelled long option name without the leading "--"
+     *
+     * @return
+     * the long option name without "--", or an empty string if none is close
+     */
+    std::string suggest(const std::string & name) const
+    {
+        return m_longNames.closest(name.data(), name.length());
+    }
+
+    /**
+     * Access a named argument
+     *
+     * The arguments are named by the "Usage:" line of the usage text, e.g.
+     *
+     * Usage: copy [options] SRC... DST:int [MODE]
+     *
+     * names SRC taking one or more arguments, DST taking one argument which
+     * must be an int, and MODE taking an optional argument. A type is written
+     * as for options, see the Constraint class. The words "[options]" and
+     * "[OPTIONS]" and options such as "[-v]" are skipped, and a line with
+     * other words in brackets is not taken as a schema. With
+     * setCheckArguments(), parse() also checks the number of arguments and
+     * their types, and reports the problems as errors.
+     *
+     * Without subcommands and a schema, the arguments are only available
+     * through arguments().
+     *
+     * @param name
+     * the name in the "Usage:" line
+     *
+     * @return
+     * the arguments taken by the name
+     *
+     * @throw
+     * std::invalid_argument if the name is not in the "Usage:" line. Without
+     * exceptions the program is aborted instead, use tryPositional() to
+     * handle the error.
+     */
+    StringValue & positional(const std::string & name)
+    {
+        auto pos = tryPositional(name);
+        if (!pos) {
+            CMDOPTION_THROW(std::invalid_argument("unknown argument: " + name));
+        }
+        return *pos.value();
+    }
+
+    /**
+     * Access the arguments taken by a name in the "Usage:" line without
+     * throwing
+     *
+     * @param name
+     * the name in the "Usage:" line
+     *
+     * @return
+     * A pointer to the arguments taken by the name, or an error if the name
+     * is not in the "Usage:" line.
+     */
+    Expected<StringValue*> tryPositional(const std::string & name)
+    {
+        auto it = m_positionalIndex.find(name);
+        if (it == m_positionalIndex.end()) {
+            return Expected<StringValue*>::failure("unknown argument");
+        }
+
+        return &m_positionals[it->second].value;
+    }
+
+    /**
+     * Overload of positional() by position in the "Usage:" line
+     */
+    StringValue & positional(std::size_t i)
+    {
+        if (i >= m_positionals.size()) {
+            CMDOPTION_THROW(std::invalid_argument("unknown argument: " + std::to_string(i)));
+        }
+        return m_positionals[i].value;
+    }
+
+    /**
+     * Access arguments
+     *
+     * @return
+     * A reference to the arguments
+     */
+    const StringValue & arguments()
+    {
+        return m_arguments;
+    }
+
+    /**
+     *
+     */
+    void reportError(std::ostream & os = std::cerr)
+    {
+        if (!good()) {
+            os << m_errorStr << std::endl;
+        }
+    }
+
+    /**
+     * Debug output
+     *
+     * It prints how the object understand the option settings.
+     */
+    void debugReport()
+    {
+        std::cout << "\n";
+        std::cout << "short option string: " << m_shortOptStr << "\n" << std::endl;
+
+        std::cout << "long options\n";
+        for (auto opt : m_longOptions) {
+            if (opt.name) {
+                std::cout << opt.name << "\t" << opt.has_arg << "\t" << (char) opt.val << std::endl;
+            }
+        }
+        std::cout << std::endl;
+
+        bool optionSet = false;
+        for (int i = 0; i < static_cast<int>(m_options.size()); ++i) {
+            if (!m_options[i]) {
+                continue;
+            }
+
+            if (!optionSet) {
+                std::cout << "options"  << std::endl;
+                optionSet = true;
+            }
+            for (auto & optItem : m_indexMap) {
+                if (optItem.second == i) {
+                    std::cout << optItem.first << " ";
+                }
+            }
+            std::cout << m_options[i].str() << std::endl;
+        }
+        if (optionSet) {
+            std::cout << std::endl;
+        }
+
+        if (m_arguments) {
+            std::cout << "arguments"  << std::endl;
+            std::cout << m_arguments.str() << "\n" << std::endl;;
+        }
+
+        if (!m_errorStr.empty()) {
+            std::cout << "error: " << m_errorStr << std::endl;
+        }
+    }
+
+private:
+
+    // what the argv elements were parsed into, see setIncremental()
+    struct Record
+    {
+        enum class Kind { Option, Argument, Forward, Error, Other };
+
+        Kind kind;
+        int index;          // option index of Option
+        int element;        // the first argv element of the unit
+        int count;          // number of argv elements in the unit
+        int argElement;     // argv element of the option argument, -1 if none
+        int argOffset;      // offset of the option argument in the element
+        bool tail;          // true if the options ended with the unit
+        std::string error;  // message of Error
+        bool negated;       // the "no-" spelling of Option
+    };
+
+    // a named argument from the "Usage:" line, see positional()
+    struct Positional
+    {
+        std::string name;
+        int min = 1;                // least number of arguments taken
+        int max = 1;                // INT_MAX if repeated
+        Constraint constraint;
+        StringValue value;
+    };
+
+    // a relation between options declared in the usage text
+    struct Rule
+    {
+        enum class Kind {Required, Exclusive, Requires};
+
+        Kind kind;
+        std::vector<std::string> names;     // as written, e.g. "--fast"
+        std::vector<int> indices;           // option index by name
+        std::vector<std::uint64_t> mask;    // the options checked, see checkRules()
+    };
+
+    /**
+     * Initialization
+     *
+     * In this function, based on usage information, we construct short option
+     * string and long option struct as required by getopt_long() function.
+     * Furthermore, as some options have both short and long option and user
+     * will provide one of them, we also construct an internal index maps to
+     * map short options and long options to an index set so that one option
+     * will map to a unique index.
+     *
+     * Note: in theory, short option and long option may have the same name,
+     * for example:
+     * -a, --all
+     * -b, --a
+     *
+     * The second long option collides with the first short option. However, this
+     * case is rare and not meaningful in practice and we just issue an error
+     * as duplicate option in this case.
+     *
+     * @param usage
+     * the usage text to add, the options found so far are kept
+     */
+    void init(const std::string & usage)
+    {
+        std::size_t names = m_longOptNames.size();
+        std::size_t values = m_options.size();
+
+        std::size_t rules = m_rules.size();
+
+        // the errors of an earlier parse are set aside, so that only the
+        // errors in the usage text stop reading it
+        std::string parseErrors = m_errorStr.substr(m_usageErrorSize);
+        m_errorStr.resize(m_usageErrorSize);
+        if (!parseErrors.empty() && parseErrors[0] == '\n') {
+            parseErrors.erase(0, 1);
+        }
+
+        std::stringstream s(usage);
+        std::string line;
+        while (good() && std::getline(s, line)) {
+            parseLine(m_usageLines++, line);
+        }
+
+        // the rules may name options declared after them
+        for (std::size_t i = rules; i < m_rules.size() && good(); ++i) {
+            compileRule(m_rules[i]);
+        }
+
+        // the names are in a deque, so the earlier pointers stay valid
+        for (size_t i = names; i < m_longOptNames.size(); ++i) {
+            m_longOptions[i].name = m_longOptNames[i].c_str();
+        }
+
+        // the maps are shared with the values
+        m_options.resize(m_maxIndex);
+        for (auto i = values; i < m_options.size(); ++i) {
+            m_options[i].setMap(m_maps[i]);
+            m_options[i].setList(m_lists[i].list);
+            CMDOPTION_STAT(m_options[i].setStats(m_stats));
+        }
+
+        // joined the way addErrorStr() does
+        m_usageErrorSize = m_errorStr.size();
+        if (!parseErrors.empty()) {
+            if (!m_errorStr.empty()) {
+                m_errorStr += "\n";
+            }
+            m_errorStr += parseErrors;
+        }
+    }
+
+    /**
+     * Parse one usage line
+     *
+     * @param i
+     * The line number of usage, used when reporting error
+     *
+     * @param line
+     * The content of the line
+     */
+    void parseLine(int i, const std::string & line)
+    {
+        if (parseUsageLine(line) || parseRuleLine(line)) {
+            return;
+        }
+        if (!parseOptLine(i, line)) {
+            addErrorStr("invalid option at line: " + std::to_string(i) + "\n" + line);
+        }
+    }
+
+    /**
+     * The implementation of parse()
+     */
+    void parseArgs(int argc, char** argv)
+    {
+        if (incremental()) {
+            reset();
+            m_recording = true;
+            scan(argc, argv);
+            m_recording = false;
+            replay(argc, argv, std::vector<char>(m_maxIndex, 1), true);
+            return;
+        }
+
+        if (m_passThrough) {
+            if (m_engine == ParseEngine::Getopt) {
+                addErrorStr("pass-through mode is not supported by getopt_long()");
+                return;
+            }
+            m_forwarded.clear();
+            pushResult(m_forwarded, argv[0]);
+        }
+
+        int first = (m_engine == ParseEngine::Getopt)?
+                parseGetopt(argc, argv): scan(argc, argv);
+
+        if (!m_subcommands.empty()) {
+            // the first argument selects the subcommand, which takes the rest
+            if (first < argc) {
+                dispatch(argc - first, argv + first);
+            }
+        }
+        else {
+            // the rest are arguments
+            while (first < argc) {
+                addArgument(argv[first++]);
+            }
+        }
+
+        if (m_passThrough) {
+            pushResult(m_forwarded, nullptr);
+        }
+    }
+
+    /**
+     * Add a non-option argument, which is also forwarded in pass-through mode
+     */
+    void addArgument(char * arg)
+    {
+        if (m_recording) {
+            record(Record::Kind::Argument, -1, nullptr);
+            return;
+        }
+
+        m_arguments.add(arg);
+        pushResult(m_argList, arg);
+        forward(arg);
+    }
+
+    /**
+     * Forward an argv element in pass-through mode
+     */
+    void forward(char * arg)
+    {
+        if (m_passThrough) {
+            if (m_recording) {
+                record(Record::Kind::Forward, -1, nullptr);
+                return;
+            }
+            pushResult(m_forwarded, arg);
+        }
+    }
+
+    /**
+     * The native implementation of parse()
+     *
+     * It takes argv element by element without reordering them, non-option
+     * arguments are added to the arguments as they are met.
+     *
+     * @return
+     * the index of the first argument left unparsed, i.e. the one after "--"
+     * or the subcommand name
+     */
+    int scan(int argc, char** argv, int i = 1, bool tail = false)
+    {
+        bool inOrder = m_requireOrder || !m_subcommands.empty() ||
+                (std::getenv("POSIXLY_CORRECT") != nullptr);
+
+        for (; i < argc; ++i) {
+            if (m_resync.old != nullptr && resynced(i, tail)) {
+                break;
+            }
+
+            const char * arg = argv[i];
+            beginUnit(argv, i);
+
+            if (tail) {
+                addArgument(argv[i]);
+            }
+            else if (arg[0] != '-' || arg[1] == 0) {
+                // not an option, "-" alone is not an option either
+                if (inOrder) {
+                    if (!m_subcommands.empty()) {
+                        break;  // the subcommand name
+                    }
+                    tail = true;
+                }
+                addArgument(argv[i]);
+            }
+            else if (arg[1] != '-') {
+                i = scanShort(argc, argv, i);
+            }
+            else if (arg[2] != 0) {
+                i = scanLong(argc, argv, i);
+            }
+            else {
+                // "--" ends the options
+                if (!m_subcommands.empty()) {
+                    return i + 1;
+                }
+                tail = true;
+            }
+
+            endUnit(i, tail);
+        }
+
+        return i;
+    }
+
+    /**
+     * Parse a long option argv[i]
+     *
+     * @return
+     * the index of the last argv element consumed
+     */
+    int scanLong(int argc, char** argv, int i)
+    {
+        const char * name = argv[i] + 2;
+        const char * eq = std::strchr(name, '=');
+        std::size_t len = (eq != nullptr)? eq - name: std::strlen(name);
+
+        int value = m_longTrie.find(name, len, m_exactMatch);
+        if (value == PrefixTrie::AMBIGUOUS) {
+            value = resolvePrefix(name, len);
+        }
+        int index = (value >= 0)? value / 2: value;
+        bool negated = (value >= 0) && (value % 2 != 0);
+        if (index == PrefixTrie::NOT_FOUND && m_passThrough) {
+            forward(argv[i]);
+            return i;
+        }
+        if (index < 0) {
+            std::string opt(argv[i], len + 2);
+            if (index == PrefixTrie::AMBIGUOUS) {
+                addErrorStr("Ambiguous option: " + opt);
+            }
+            else {
+                std::string guess = m_longNames.closest(name, len);
+                addErrorStr("Unknown option: " + opt +
+                        (guess.empty()? "": " (did you mean --" + guess + "?)"));
+            }
+            return i;
+        }
+
+        switch (m_argReqmts[index]) {
+        case no_argument:
+            if (eq != nullptr) {
+                addErrorStr("Unexpected argument for: " + std::string(argv[i], len + 2));
+                return i;
+            }
+            store(index, nullptr, negated);
+            break;
+
+        case required_argument:
+            if (eq != nullptr) {
+                store(index, eq + 1);
+            }
+            else if (i + 1 < argc) {
+                store(index, argv[++i]);
+            }
+            else {
+                addErrorStr(std::string("Missing argument for: ") + argv[i]);
+            }
+            break;
+
+        default:
+            // optional argument is accepted only after "="
+            store(index, (eq != nullptr)? eq + 1: nullptr);
+            break;
+        }
+
+        return i;
+    }
+
+    /**
+     * Resolve an abbreviation of several long options the way getopt_long()
+     * does: it stands for the first of them if they all take an argument in
+     * the same way and return the same short option
+     *
+     * @return
+     * the value of the long option in the trie, or PrefixTrie::AMBIGUOUS
+     */
+    int resolvePrefix(const char * name, std::size_t len) const
+    {
+        const struct option * found = nullptr;
+        for (const struct option & opt : m_longOptions) {
+            if (opt.name == nullptr || std::strncmp(opt.name, name, len) != 0) {
+                continue;
+            }
+            if (found == nullptr) {
+                found = &opt;
+            }
+            else if (opt.has_arg != found->has_arg || opt.val != found->val) {
+                return PrefixTrie::AMBIGUOUS;
+            }
+        }
+
+        if (found == nullptr) {
+            return PrefixTrie::AMBIGUOUS;
+        }
+        return m_longTrie.find(found->name, std::strlen(found->name), true);
+    }
+
+    /**
+     * Parse the short options in argv[i], e.g. "-a" or "-abc"
+     *
+     * @return
+     * the index of the last argv element consumed
+     */
+    int scanShort(int argc, char** argv, int i)
+    {
+        const char * p = argv[i] + 1;
+        while (*p != 0) {
+            char c = *p++;
+
+            const ShortOption & opt = m_shortOptions[static_cast<unsigned char>(c)];
+            if (opt.index < 0 && m_passThrough && p == argv[i] + 2) {
+                // forward the element as a whole, it is not ours
+                forward(argv[i]);
+                break;
+            }
+            if (opt.index < 0) {
+                addErrorStr(std::string("Unknown option: -") + c);
+                continue;
+            }
+
+            int index = opt.index;
+            int argReqmt = opt.argReqmt;
+            if (argReqmt == no_argument) {
+                store(index, nullptr);
+                continue;
+            }
+
+            // the rest of the element is the argument, or else the next one
+            if (*p != 0) {
+                store(index, p);
+            }
+            else if (i + 1 < argc) {
+                store(index, argv[++i]);
+            }
+            else {
+                addErrorStr(std::string("Missing argument for: -") + c);
+            }
+            break;
+        }
+
+        return i;
+    }
+
+    /**
+     * The getopt_long() implementation of parse()
+     *
+     * @return
+     * the index of the first argument left unparsed
+     */
+    int parseGetopt(int argc, char** argv)
+    {
+        opterr = 0; // tell getopt_long not to print invalid option on screen
+        m_unitStart = -1;   // the positions are not known
+
+        std::string optStr = m_shortOptStr;
+        if (m_requireOrder && optStr[0] != '+') {
+            optStr.insert(0, "+");
+        }
+
+        while (true) {
+            int option_index = 0;
+
+            int c = getopt_long(argc, argv, optStr.c_str(),
+                    &m_longOptions[0], &option_index);
+
+            if (c < 0) {
+                // no more options
+                break;
+            }
+
+            int index;
+            if (c == 0) {
+                // get a long option
+
+                const std::string & name = m_longOptNames[option_index];
+                int value = m_longTrie.find(name.data(), name.length(), true);
+                store(value / 2, optarg, value % 2 != 0);
+                continue;
+            }
+            else if (c == '?') {
+                // unknown option
+                addErrorStr(std::string("Unknown option: ") + char(optopt));
+                continue;
+            }
+            else if (c == ':') {
+                // missing option argument
+                addErrorStr(std::string("Missing argument for: ") + char(optopt));
+                continue;
+            }
+            else {
+                // a short option
+                index = m_shortOptions[static_cast<unsigned char>(c)].index;
+                if (index < 0) {
+                    addErrorStr(std::string("unknown short option: ") + char(c));
+                    break;
+                }
+            }
+
+            store(index, optarg);
+        }
+
+        int first = optind;
+
+        // reset the global variable in case multiple parsings are required
+        optind = 0;
+
+        return first;
+    }
+
+    /**
+     * Get the width of the terminal
+     *
+     * @return
+     * the width of the terminal at fd, or $COLUMNS, or 80
+     */
+    static int terminalWidth(int fd = STDOUT_FILENO)
+    {
+        struct winsize ws;
+        if (::ioctl(fd, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) {
+            return ws.ws_col;
+        }
+
+        const char * columns = std::getenv("COLUMNS");
+        if (columns != nullptr && std::atoi(columns) > 0) {
+            return std::atoi(columns);
+        }
+        return 80;
+    }
+
+    /**
+     * The implementation of help()
+     */
+    std::string renderHelp(int width) const
+    {
+        struct Line
+        {
+            std::string raw;
+            std::string indent;
+            std::string spec;   // option names of an option line
+            std::string text;
+        };
+
+        // split the lines, and find the column of the descriptions
+        std::vector<Line> lines;
+        std::size_t column = 0;
+        std::stringstream ss(m_usage);
+        std::string line;
+        while (std::getline(ss, line)) {
+            Line l;
+            l.raw = line;
+            std::size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos) {
+                lines.push_back(l);
+                continue;
+            }
+            l.indent = line.substr(0, start);
+
+            std::size_t pos = start;
+            if (line[start] == '-' && line.length() > start + 1 && line[start + 1] != ' ') {
+                // the option words, and "-f FILE" when nothing follows
+                std::size_t next = pos;
+                while (next != std::string::npos && line[next] == '-') {
+                    pos = line.find(' ', next);
+                    next = line.find_first_not_of(' ', pos);
+                }
+                std::size_t words = std::count(line.begin() + start, line.end(), ' ') + 1;
+                if (next != std::string::npos && line.find(' ', next) == std::string::npos &&
+                        words == 2) {
+                    pos = std::string::npos;
+                    next = std::string::npos;
+                }
+                l.spec = line.substr(start, pos - start);
+                if (next != std::string::npos) {
+                    l.text = line.substr(next);
+                    column = std::max(column, l.indent.length() + l.spec.length() + 2);
+                }
+            }
+            else {
+                l.text = line.substr(start);
+            }
+            lines.push_back(l);
+        }
+        column = std::min<std::size_t>(column, width / 3);
+
+        std::string out;
+        out.reserve(m_usage.size() + m_usage.size() / 4);
+        for (const Line & l : lines) {
+            if ((l.spec.empty() || l.text.empty()) &&
+                    l.raw.length() <= static_cast<std::size_t>(width)) {
+                out += l.raw + "\n";   // keep the line as it is
+                continue;
+            }
+
+            std::string head = l.indent + l.spec;
+            std::string indent = l.indent;
+            if (!l.spec.empty() && !l.text.empty()) {
+                if (head.length() + 2 > column) {
+                    out += head + "\n";
+                    head.clear();
+                }
+                head.resize(column, ' ');
+                indent.assign(column, ' ');
+            }
+            wrap(out, head, indent, l.text, width);
+        }
+        return out;
+    }
+
+    /**
+     * Append the text to out in lines of the given width
+     *
+     * @param head
+     * what goes before the first line
+     *
+     * @param indent
+     * what goes before the other lines
+     */
+    static void wrap(std::string & out, const std::string & head,
+            const std::string & indent, const std::string & text, int width)
+    {
+        std::size_t lineStart = out.size();
+        out += head;
+        std::size_t pos = 0;
+        bool first = true;
+        while (pos < text.length()) {
+            std::size_t end = text.find(' ', pos);
+            if (end == std::string::npos) {
+                end = text.length();
+            }
+
+            std::size_t wordLen = end - pos;
+            std::size_t lineLen = out.size() - lineStart;
+            if (!first && lineLen + 1 + wordLen > static_cast<std::size_t>(width)) {
+                out += "\n";
+                lineStart = out.size();
+                out += indent;
+                first = true;
+            }
+            if (!first) {
+                out += ' ';
+            }
+            out.append(text, pos, wordLen);
+            first = false;
+
+            pos = text.find_first_not_of(' ', end);
+            if (pos == std::string::npos) {
+                break;
+            }
+        }
+        out += "\n";
+    }
+
+    /**
+     * Get the spellings of the options by index, e.g. {"-a", "--all"}
+     */
+    std::vector<std::vector<std::string>> optionNames() const
+    {
+        std::vector<std::vector<std::string>> names(m_maxIndex);
+        for (int c = 0; c < 256; ++c) {
+            int index = m_shortOptions[c].index;
+            if (index >= 0) {
+                names[index].push_back(std::string("-") + static_cast<char>(c));
+            }
+        }
+        for (auto & name : m_longOptNames) {
+            auto it = m_indexMap.find(name);
+            if (it != m_indexMap.end()) {
+                names[it->second].push_back("--" + name);
+            }
+        }
+        return names;
+    }
+
+    /**
+     * Get the names of the subcommands in ascending order
+     */
+    std::vector<std::string> subcommandNames() const
+    {
+        std::vector<std::string> names;
+        for (auto & item : m_subcommands) {
+            names.push_back(item.first);
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    /**
+     * Tell how an option argument is completed from its placeholder
+     *
+     * @return
+     * "f" for files, "d" for directories or "" for anything else
+     */
+    static const char * argKind(const std::string & argName)
+    {
+        if (argName.find("DIR") != std::string::npos) {
+            return "d";
+        }
+        if (argName.find("FILE") != std::string::npos ||
+                argName.find("PATH") != std::string::npos) {
+            return "f";
+        }
+        return "";
+    }
+
+    /**
+     * Check if the incremental mode is in effect
+     */
+    bool incremental() const
+    {
+        return m_incremental && m_engine == ParseEngine::Native &&
+                m_subcommands.empty();
+    }
+
+    /**
+     * The implementation of reparse(), scans the elements around the edit
+     * and takes over the records of the last parse for the rest
+     */
+    void rescan(int argc, char** argv, int first, int removed, int inserted)
+    {
+        std::vector<Record> old;
+        old.swap(m_records);
+
+        // start from the unit with the element before the edit, an option in
+        // it may take the argument from the edited elements
+        int restart = (first > 1)? first - 1: 1;
+        std::size_t r = 0;
+        while (r < old.size() && old[r].element + old[r].count <= restart) {
+            ++r;
+        }
+        while (r > 0 && r < old.size() && old[r - 1].element == old[r].element) {
+            --r;
+        }
+        int start = (r < old.size())? old[r].element: restart;
+        bool tail = (r > 0) && old[r - 1].tail;
+
+        m_records.assign(std::make_move_iterator(old.begin()),
+                std::make_move_iterator(old.begin() + r));
+        std::size_t scanned = m_records.size();
+
+        int delta = inserted - removed;
+        m_resync = {&old, r, delta, first + inserted, false};
+        m_recording = true;
+        scan(argc, argv, start, tail);
+        m_recording = false;
+
+        std::size_t rescanned = m_records.size();
+        std::size_t q = m_resync.found? m_resync.next: old.size();
+        m_resync = Resync();
+
+        // take over the old records after the edit
+        for (std::size_t k = q; k < old.size(); ++k) {
+            Record & rec = old[k];
+            rec.element += delta;
+            if (rec.argElement >= 0) {
+                rec.argElement += delta;
+            }
+            pushResult(m_records, std::move(rec));
+        }
+
+        // the options with records gone or added are built again
+        std::vector<char> affected(m_maxIndex, 0);
+        bool arguments = false;
+        auto mark = [&](const Record & rec) {
+            if (rec.kind == Record::Kind::Option) {
+                affected[rec.index] = 1;
+            }
+            else if (rec.kind == Record::Kind::Argument) {
+                arguments = true;
+            }
+        };
+        for (std::size_t k = r; k < q; ++k) {
+            mark(old[k]);   // not moved
+        }
+        for (std::size_t k = scanned; k < rescanned; ++k) {
+            mark(m_records[k]);
+        }
+
+        // the pairs and elements are views into argv, so they are split
+        // again from the edited command line
+        for (int i = 0; i < m_maxIndex; ++i) {
+            if (m_maps[i] || m_lists[i].list) {
+                affected[i] = 1;
+            }
+        }
+
+        replay(argc, argv, affected, arguments);
+
+        // the options given after the edit have moved
+        for (std::size_t k = rescanned; delta != 0 && k < m_records.size(); ++k) {
+            if (m_records[k].kind == Record::Kind::Option) {
+                m_options[m_records[k].index].setPosition(m_records[k].element);
+            }
+        }
+
+        assignPositionals();
+        checkRules();
+    }
+
+    /**
+     * Start recording the unit of argv elements starting at argv[i]
+     */
+    void beginUnit(char** argv, int i)
+    {
+        m_unitStart = i;
+        if (m_recording) {
+            m_unitArgv = argv;
+            m_unitRecord = m_records.size();
+        }
+    }
+
+    /**
+     * Finish recording the unit, which ends at argv[last]
+     *
+     * @param tail
+     * true if the options have ended
+     */
+    void endUnit(int last, bool tail)
+    {
+        if (!m_recording) {
+            return;
+        }
+
+        if (m_unitRecord == m_records.size()) {
+            // e.g. "--", every unit needs a record
+            record(Record::Kind::Other, -1, nullptr);
+        }
+        for (std::size_t k = m_unitRecord; k < m_records.size(); ++k) {
+            m_records[k].count = last - m_unitStart + 1;
+            m_records[k].tail = tail;
+        }
+    }
+
+    /**
+     * Add a record of the current unit
+     *
+     * @param arg
+     * the option argument, which is in the first element of the unit or is
+     * the next element
+     */
+    void record(Record::Kind kind, int index, const char * arg)
+    {
+        Record rec = {kind, index, m_unitStart, 1, -1, 0, false, std::string(), false};
+        if (arg != nullptr) {
+            const char * element = m_unitArgv[m_unitStart];
+            std::size_t offset = arg - element;
+            if (arg >= element && offset <= std::strlen(element)) {
+                rec.argElement = m_unitStart;
+                rec.argOffset = static_cast<int>(offset);
+            }
+            else {
+                rec.argElement = m_unitStart + 1;
+            }
+        }
+        pushResult(m_records, rec);
+    }
+
+    /**
+     * Append an item to the results, the allocation is counted in the
+     * statistics when the vector grows
+     */
+    template<typename T, typename U>
+    void pushResult(std::vector<T> & vec, U && item)
+    {
+        CMDOPTION_STAT(if (vec.size() == vec.capacity()) ++m_stats->allocations);
+        vec.push_back(std::forward<U>(item));
+    }
+
+    /**
+     * Check if reparse() can take over the old records from argv[i] on
+     *
+     * That is the case if an old unit started at the same element before the
+     * edit, and the options had not ended there in either parse or ended in
+     * both.
+     */
+    bool resynced(int i, bool tail)
+    {
+        if (i < m_resync.from) {
+            return false;
+        }
+
+        const std::vector<Record> & old = *m_resync.old;
+        std::size_t & q = m_resync.next;
+        while (q < old.size() && old[q].element < i - m_resync.delta) {
+            ++q;
+        }
+
+        m_resync.found = (q < old.size()) &&
+                (old[q].element == i - m_resync.delta) &&
+                ((q > 0) && old[q - 1].tail) == tail;
+        return m_resync.found;
+    }
+
+    /**
+     * Build the results from the records
+     *
+     * @param affected
+     * the flags of the options to build, by index
+     *
+     * @param arguments
+     * true to build the arguments
+     */
+    void replay(int argc, char** argv, const std::vector<char> & affected, bool arguments)
+    {
+        for (std::size_t i = 0; i < affected.size(); ++i) {
+            if (affected[i]) {
+                m_options[i].clear();
+            }
+        }
+        if (arguments) {
+            m_arguments.clear();
+        }
+        m_argList.clear();
+        m_errorStr.resize(m_usageErrorSize);
+        if (m_passThrough) {
+            m_forwarded.clear();
+            pushResult(m_forwarded, argv[0]);
+        }
+
+        for (const Record & rec : m_records) {
+            switch (rec.kind) {
+            case Record::Kind::Option:
+                if (affected[rec.index]) {
+                    m_unitStart = rec.element;
+                    store(rec.index, (rec.argElement < 0 || rec.argElement >= argc)?
+                            nullptr: argv[rec.argElement] + rec.argOffset, rec.negated);
+                }
+                break;
+
+            case Record::Kind::Argument:
+                if (arguments) {
+                    m_arguments.add(argv[rec.element]);
+                }
+                pushResult(m_argList, argv[rec.element]);
+                forward(argv[rec.element]);
+                break;
+
+            case Record::Kind::Forward:
+                forward(argv[rec.element]);
+                break;
+
+            case Record::Kind::Error:
+                addErrorStr(rec.error);
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        if (m_passThrough) {
+            pushResult(m_forwarded, nullptr);
+        }
+    }
+
+    /**
+     * Store a value of the option with given index
+     *
+     * @param arg
+     * the option argument, nullptr if there is none
+     */
+    void store(int index, const char * arg, bool negated = false)
+    {
+        if (m_recording) {
+            // an invalid value is recorded as its error, which is replayed
+            // even if the option is not affected by an edit
+            StringValue checked;
+            if (arg != nullptr && m_argReqmts[index] != no_argument &&
+                    !validate(index, arg, checked)) {
+                return;
+            }
+            record(Record::Kind::Option, index, arg);
+            m_records.back().negated = negated;
+            return;
+        }
+
+        CMDOPTION_STAT(++m_stats->optionHits);
+        StringValue & value = m_options[index];
+        value.setNegated(negated);
+        value.setPosition(m_unitStart);
+        if (m_argReqmts[index] == no_argument) {
+            value.mark();   // a switch is only counted
+            return;
+        }
+
+        if (arg != nullptr && !validate(index, arg, value)) {
+            return;
+        }
+        if (m_maps[index]) {
+            CMDOPTION_STAT(std::size_t capacity = m_maps[index]->capacity());
+            m_maps[index]->insert((arg != nullptr)? arg: "");
+            CMDOPTION_STAT(if (m_maps[index]->capacity() != capacity) ++m_stats->allocations);
+            value.mark();
+            return;
+        }
+        if (m_lists[index].list && arg != nullptr) {
+            CMDOPTION_STAT(std::size_t capacity = m_lists[index].list->capacity());
+            m_lists[index].list->split(arg, std::strlen(arg), m_lists[index].sep);
+            CMDOPTION_STAT(if (m_lists[index].list->capacity() != capacity) ++m_stats->allocations);
+            value.mark();
+            return;
+        }
+        value.add((arg != nullptr)? arg: "");
+    }
+
+    /**
+     * Check a value of the option with given index against its choices and
+     * its type, and report it if it is not valid
+     *
+     * @param value
+     * where the position in the choices and the converted number are kept
+     *
+     * @return
+     * true if the value is valid
+     */
+    bool validate(int index, const char * arg, StringValue & value)
+    {
+        const ChoiceSet & choices = m_choices[index];
+        if (!choices.empty()) {
+            int choice = choices.find(arg, std::strlen(arg));
+            if (choice < 0) {
+                addErrorStr(invalidChoice(index, arg));
+                return false;
+            }
+            value.setChoice(choice);
+        }
+        const Constraint & constraint = m_constraints[index];
+        if (!constraint.empty() && !constraint.check(arg, value)) {
+            addErrorStr("Invalid value for " + optionNames()[index].back() + ": " +
+                    arg + " (expected " + constraint.spec() + ")");
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Make the error message for a value not in the choices of an option
      */
-    void operator<<(const std::string & usage)
+    std::string invalidChoice(int index, const char * arg) const
     {
-        m_usage = usage;
-        init();
+        std::string msg = "Invalid value for " + optionNames()[index].back() +
+                ": " + arg + " (choose from";
+        const char * sep = " ";
+        for (auto & word : m_choices[index].words()) {
+            msg += sep + word;
+            sep = ", ";
+        }
+        return msg + ")";
     }
 
     /**
-     * Show usage
+     * Select the subcommand named by argv[0] and let it parse the rest
      *
-     * @param os
-     * output stream, default is std::cout
+     * The subcommand's usage text is parsed here the first time it is
+     * selected.
      */
-    void usage(std::ostream& os = std::cout)
+    void dispatch(int argc, char** argv)
     {
-        os << m_usage << std::endl;
+        auto it = m_subcommands.find(argv[0]);
+        if (it == m_subcommands.end()) {
+            addErrorStr(std::string("Unknown command: ") + argv[0]);
+            return;
+        }
+
+        Subcommand & cmd = it->second;
+        if (!cmd.option) {
+            CMDOPTION_STAT(++m_stats->allocations);
+            cmd.option.reset(new CmdOption);
+            *cmd.option << cmd.usage;
+        }
+        else {
+            CMDOPTION_STAT(++m_stats->cacheHits);
+        }
+
+        // the subcommand is parsed the same way as the tool
+        CmdOption & sub = *cmd.option;
+        sub.m_engine = m_engine;
+        sub.m_exactMatch = m_exactMatch;
+        sub.m_requireOrder = m_requireOrder;
+        sub.m_passThrough = m_passThrough;
+        sub.m_checkArguments = m_checkArguments;
+
+        m_subcommand = it->first;
+        sub.parse(argc, argv);
+        if (!sub.good()) {
+            addErrorStr(sub.m_errorStr);
+        }
+
+        // the subcommand name and what the subcommand forwards follow the
+        // elements forwarded before it
+        if (m_passThrough && !sub.m_forwarded.empty()) {
+            m_forwarded.insert(m_forwarded.end(), sub.m_forwarded.begin(), sub.m_forwarded.end() - 1);
+        }
     }
 
     /**
-     * Check the status of the object
-     *
-     * @return
-     * true if no error encountered
+     * Add error string
      */
-    bool good()
+    void addErrorStr(const std::string & str)
     {
-        return m_errorStr.empty();
+        if (m_recording) {
+            record(Record::Kind::Error, -1, nullptr);
+            m_records.back().error = str;
+            return;
+        }
+
+        if (!m_errorStr.empty()) {
+            m_errorStr += "\n";
+        }
+        m_errorStr += str;
     }
 
     /**
-     * Parse the command line
+     * Read the names of the arguments from the first "Usage:" line, see
+     * positional()
      *
-     * @param argc
-     * @param argv
-     * The parameters passed to main()
+     * @return
+     * true if the line is the "Usage:" line
      */
-    void parse(int argc, char** argv)
+    bool parseUsageLine(const std::string & line)
     {
-        opterr = 0; // tell getopt_long not to print invalid option on screen
-
-        while (true) {
-            int this_option_optind = optind ? optind : 1;
-            int option_index = 0;
-
-            int c = getopt_long(argc, argv, m_shortOptStr.c_str(),
-                    &m_longOptions[0], &option_index);
-
-            if (c < 0) {
-                // no more options
-                break;
-            }
-
-            int index;
-            if (c == 0) {
-                // get a long option
+        std::stringstream ss(line);
+        std::string word;
+        if (m_usageSeen || !(ss >> word) || (word != "Usage:" && word != "usage:")) {
+            return false;
+        }
+        m_usageSeen = true;
+        ss >> word;     // the program
 
-                index = m_indexMap[m_longOptNames[option_index]];
-            }
-            else if (c == '?') {
-                // unknown option
-                addErrorStr(std::string("Unknown option: ") + char(optopt));
+        std::vector<Positional> positionals;
+        bool skipping = false;  // in an option such as "[-o FILE]"
+        int variadic = 0;
+        while (ss >> word) {
+            if (skipping || word[0] == '-' || word.compare(0, 2, "[-") == 0) {
+                skipping = (word[0] == '[' || skipping) && word.back() != ']';
                 continue;
             }
-            else if (c == ':') {
-                // missing option argument
-                addErrorStr(std::string("Missing argument for: ") + char(optopt));
+
+            if (word == "[options]" || word == "[OPTIONS]") {
                 continue;
             }
-            else {
-                // a short option
-                std::string str;
-                str = (char)c;
-                auto it = m_indexMap.find(str);
-                if (it == m_indexMap.end()) {
-                    addErrorStr(std::string("unknown short option: ") + str);
-                    break;
-                }
 
-                index = it->second;
+            Positional pos;
+            if (word[0] == '[') {
+                if (word.back() != ']') {
+                    return true;    // not a schema
+                }
+                word = word.substr(1, word.length() - 2);
+                pos.min = 0;
+            }
+            if (word.length() > 3 && word.compare(word.length() - 3, 3, "...") == 0) {
+                word.resize(word.length() - 3);
+                pos.max = INT_MAX;
+                ++variadic;
+            }
+            if (word.length() > 2 && word[0] == '<' && word.back() == '>') {
+                word = word.substr(1, word.length() - 2);
             }
 
-            if (optarg) {
-                m_options[index].add(optarg);
+            auto colon = word.find(':');
+            pos.name = word.substr(0, colon);
+            if (pos.name.empty() || std::find_if(pos.name.begin(), pos.name.end(), [](char c) {
+                    return !std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-';
+                }) != pos.name.end()) {
+                return true;    // not a schema
             }
-            else {
-                m_options[index].add("");
+            if (colon != std::string::npos && !pos.constraint.compile(word.substr(colon + 1))) {
+                // e.g. "HOST:PORT" is not a schema, while "N:int[1," is a mistake
+                if (word.find_first_of("[(", colon) != std::string::npos) {
+                    addErrorStr("invalid constraint: " + word);
+                }
+                return true;
             }
+            positionals.push_back(std::move(pos));
         }
 
-        if (optind < argc) {
-            // the rest are arguments
-            while (optind < argc) {
-                m_arguments.add(argv[optind++]);
-            }
+        if (variadic > 1) {
+            addErrorStr("more than one repeated argument in: " + line);
+            return true;
         }
 
-        // reset the global variable in case multiple parsings are required
-        optind = 0;
+        m_positionals = std::move(positionals);
+        for (std::size_t i = 0; i < m_positionals.size(); ++i) {
+            m_positionalIndex[m_positionals[i].name] = static_cast<int>(i);
+            CMDOPTION_STAT(m_positionals[i].value.setStats(m_stats));
+        }
+        return true;
     }
 
     /**
-     * Access an option
+     * Give the arguments to the names of the "Usage:" line, see positional()
      *
-     * @param opt
-     * short or long option name
-     *
-     * @return
-     * A StringValue object that can be converted to various types
+     * The names take their least number of arguments first, the optional
+     * ones then take one more each from the left, and a repeated one takes
+     * the rest.
      */
-    StringValue& operator[](const std::string & opt)
+    void assignPositionals()
     {
-        auto it = m_indexMap.find(opt);
-        if (it == m_indexMap.end()) {
-            throw std::invalid_argument("unknown option: " + opt);
+        if (m_positionals.empty() || !m_subcommands.empty()) {
+            return;
         }
 
-        int index = it->second;
+        int least = 0;
+        for (auto & pos : m_positionals) {
+            least += pos.min;
+            pos.value.clear();
+        }
 
-        auto it2 = m_options.find(index);
-        if (it2 == m_options.end()) {
-            return m_nullStrValue;
+        int count = static_cast<int>(m_argList.size());
+        int spare = count - least;
+        m_takes.resize(m_positionals.size());
+        for (std::size_t i = 0; i < m_positionals.size(); ++i) {
+            const Positional & pos = m_positionals[i];
+            m_takes[i] = pos.min;
+            if (pos.max == 1 && pos.min == 0 && spare > 0) {
+                m_takes[i] = 1;
+                --spare;
+            }
+        }
+        for (std::size_t i = 0; i < m_positionals.size() && spare > 0; ++i) {
+            if (m_positionals[i].max > 1) {
+                m_takes[i] += spare;
+                spare = 0;
+            }
         }
 
-        return it2->second;
+        int next = 0;
+        for (std::size_t i = 0; i < m_positionals.size(); ++i) {
+            Positional & pos = m_positionals[i];
+            for (int k = 0; k < m_takes[i]; ++k, ++next) {
+                if (next >= count) {
+                    if (m_checkArguments) {
+                        addErrorStr("Missing argument: " + pos.name);
+                    }
+                    return;
+                }
+
+                const char * arg = m_argList[next];
+                if (!pos.constraint.empty() && !pos.constraint.check(arg, pos.value) &&
+                        m_checkArguments) {
+                    addErrorStr("Invalid value for " + pos.name + ": " + arg +
+                            " (expected " + pos.constraint.spec() + ")");
+                    continue;
+                }
+                pos.value.add(arg);
+            }
+        }
+        if (next < count && m_checkArguments) {
+            addErrorStr(std::string("Unexpected argument: ") + m_argList[next]);
+        }
     }
 
     /**
-     * Access arguments
+     * Read a rule line such as "Exclusive: --fast --safe"
      *
      * @return
-     * A reference to the arguments
+     * false if the line is not a rule, e.g. "Required: an input file"
      */
-    const StringValue & arguments()
+    bool parseRuleLine(const std::string & line)
     {
-        return m_arguments;
+        static const char * const kinds[] = {"Required:", "Exclusive:", "Requires:"};
+
+        std::stringstream ss(line);
+        std::string word;
+        ss >> word;
+        auto kind = std::find_if(std::begin(kinds), std::end(kinds),
+                [&](const char * k) { return word == k; });
+        if (kind == std::end(kinds)) {
+            return false;
+        }
+
+        Rule rule;
+        rule.kind = static_cast<Rule::Kind>(kind - std::begin(kinds));
+        while (ss >> word) {
+            if (word.back() == ',') {
+                word.pop_back();
+            }
+            if (word.length() < 2 || word[0] != '-') {
+                return false;
+            }
+            rule.names.push_back(word);
+        }
+
+        std::size_t min = (rule.kind == Rule::Kind::Required)? 1: 2;
+        if (rule.names.size() < min) {
+            return false;
+        }
+        m_rules.push_back(std::move(rule));
+        return true;
     }
 
     /**
-     *
+     * Turn the names of a rule into option indices and a bitmask over them
      */
-    void reportError(std::ostream & os = std::cerr)
+    void compileRule(Rule & rule)
     {
-        if (!good()) {
-            os << m_errorStr << std::endl;
+        rule.mask.assign((m_maxIndex + 63) / 64, 0);
+        for (std::size_t i = 0; i < rule.names.size(); ++i) {
+            const std::string & name = rule.names[i];
+            auto it = m_indexMap.find(name.substr((name[1] == '-')? 2: 1));
+            if (it == m_indexMap.end()) {
+                addErrorStr("unknown option in rule: " + name);
+                return;
+            }
+
+            int index = it->second;
+            rule.indices.push_back(index);
+            if (i > 0 || rule.kind != Rule::Kind::Requires) {
+                rule.mask[index / 64] |= std::uint64_t(1) << (index % 64);
+            }
+            if (std::find(m_ruleOptions.begin(), m_ruleOptions.end(), index) == m_ruleOptions.end()) {
+                m_ruleOptions.push_back(index);
+            }
         }
     }
 
     /**
-     * Debug output
+     * Check the rules against the options given, see operator<<
      *
-     * It prints how the object understand the option settings.
+     * Only the options named in rules are looked at to make the bitset of
+     * options present, then each rule takes one AND per 64 options.
      */
-    void debugReport()
+    void checkRules()
     {
-        std::cout << "\n";
-        std::cout << "short option string: " << m_shortOptStr << "\n" << std::endl;
+        if (m_rules.empty() || !m_errorStr.empty()) {
+            return;
+        }
 
-        std::cout << "long options\n";
-        for (auto opt : m_longOptions) {
-            if (opt.name) {
-                std::cout << opt.name << "\t" << opt.has_arg << "\t" << (char) opt.val << std::endl;
+        m_present.assign((m_maxIndex + 63) / 64, 0);
+        for (int index : m_ruleOptions) {
+            if (m_options[index]) {
+                m_present[index / 64] |= std::uint64_t(1) << (index % 64);
             }
         }
-        std::cout << std::endl;
 
-        if (!m_options.empty()) {
-            std::cout << "options"  << std::endl;
-            for (auto & item : m_options) {
-                for (auto & optItem : m_indexMap) {
-                    if (optItem.second == item.first) {
-                        std::cout << optItem.first << " ";
-                    }
-                }
-                std::cout << item.second.str() << std::endl;
+        for (const Rule & rule : m_rules) {
+            int given = 0;          // options of the mask present
+            bool missing = false;   // options of the mask absent
+            for (std::size_t w = 0; w < rule.mask.size(); ++w) {
+                std::uint64_t present = rule.mask[w] & m_present[w];
+                given += __builtin_popcountll(present);
+                missing = missing || (present != rule.mask[w]);
             }
-            std::cout << std::endl;
-        }
 
-        if (m_arguments) {
-            std::cout << "arguments"  << std::endl;
-            std::cout << m_arguments.str() << "\n" << std::endl;;
-        }
+            switch (rule.kind) {
+            case Rule::Kind::Required:
+                if (missing) {
+                    addErrorStr("Missing required option: " + ruleNames(rule, 0, false));
+                }
+                break;
 
-        if (!m_errorStr.empty()) {
-            std::cout << "error: " << m_errorStr << std::endl;
+            case Rule::Kind::Exclusive:
+                if (given > 1) {
+                    addErrorStr("Options cannot be used together: " + ruleNames(rule, 0, true));
+                }
+                break;
+
+            default:
+                if (missing && m_options[rule.indices[0]]) {
+                    addErrorStr(rule.names[0] + " requires " + ruleNames(rule, 1, false));
+                }
+                break;
+            }
         }
     }
 
-private:
-
     /**
-     * Initialization
-     *
-     * In this function, based on usage information, we construct short option
-     * string and long option struct as required by getopt_long() function.
-     * Furthermore, as some options have both short and long option and user
-     * will provide one of them, we also construct an internal index maps to
-     * map short options and long options to an index set so that one option
-     * will map to a unique index.
-     *
-     * Note: in theory, short option and long option may have the same name,
-     * for example:
-     * -a, --all
-     * -b, --a
-     *
-     * The second long option collides with the first short option. However, this
-     * case is rare and not meaningful in practice and we just issue an error
-     * as duplicate option in this case.
+     * List the names of a rule from the i-th one that are present or absent
      */
-    void init()
+    std::string ruleNames(const Rule & rule, std::size_t i, bool present) const
     {
-        std::stringstream s(m_usage);
-        std::string line;
-        int i = 0;
-        while (good() && std::getline(s, line)) {
-            parseLine(i++, line);
-        }
-
-        m_longOptions.push_back({0, 0, 0, 0});
-        for (size_t i = 0; i < m_longOptNames.size(); ++i) {
-            m_longOptions[i].name = m_longOptNames[i].c_str();
+        std::string names;
+        for (; i < rule.names.size(); ++i) {
+            if (static_cast<bool>(m_options[rule.indices[i]]) == present) {
+                names += (names.empty()? "": ", ") + rule.names[i];
+            }
         }
+        return names;
     }
 
     /**
-     * Parse one usage line
+     * Add a spelling of the long option with index m_maxIndex
      *
-     * @param i
-     * The line number of usage, used when reporting error
+     * @param shortOpt
+     * the short option getopt_long() returns for it, 0 for none
      *
-     * @param line
-     * The content of the line
+     * @param negated
+     * true for the "no-" spelling of a switch
+     *
+     * @return
+     * false if the name is a duplicate
      */
-    void parseLine(int i, const std::string & line)
+    bool addLongOption(const std::string & longOpt, int argReqmt, char shortOpt, bool negated)
     {
-        if (!parseOptLine(i, line)) {
-            addErrorStr("invalid option at line: " + std::to_string(i) + "\n" + line);
-        }
-    }
+        m_longOptNames.push_back(longOpt);
+        // keep the terminating entry, do not set the pointer at the moment
+        m_longOptions.insert(m_longOptions.end() - 1, {0, argReqmt, 0, shortOpt});
 
-    /**
-     * Add error string
-     */
-    void addErrorStr(const std::string & str)
-    {
-        if (!m_errorStr.empty()) {
-            m_errorStr += "\n";
+        if (m_indexMap.find(longOpt) != m_indexMap.end()) {
+            addErrorStr("duplicate long option: " + longOpt);
+            return false;
         }
-        m_errorStr += str;
+
+        m_indexMap[longOpt] = m_maxIndex;
+        m_longTrie.insert(longOpt.data(), longOpt.length(), m_maxIndex * 2 + negated);
+        m_longNames.insert(longOpt.data(), longOpt.length(), m_maxIndex * 2 + negated);
+        return true;
     }
 
     /**
@@ -574,66 +4479,86 @@ private:
         std::stringstream ss(line);
 
         std::string word;
-        char shortOpt = 0;
-        std::string longOpt;
-        int argReqmt = 0;
+        std::string shortOpts;              // e.g. "oO" of "-o, -O"
+        std::vector<std::string> longOpts;  // e.g. "out", "output"
+        std::string argName;    // e.g. FILE
+        int argReqmt = no_argument;
+        bool longArg = false;   // the argument is given with a long option
+        bool negatable = false; // e.g. "--[no-]color"
+
+        // the words after the options, we need to count them for
+        // disambiguation, e.g.
+        //
+        // -f this is explanation
+        // -f FILE
+        //    This is explanation
+        //
+        // we consider FILE as argument becuase there is no explanation
+        // text after it.
+        int rest = 0;
+        std::string restWord;
 
         int n = 0;  // number of words encountered
         while (ss >> word) {
             ++n;
 
-            if (n > 2) {
-                // we need to count the number of words for disambiguation, e.g.
-
-                // -f this is explanation
-                // -f FILE
-                //    This is explanation
-                //
-                // we consider FILE as argument becuase there is no explanation
-                // text after it.
-                break;
-            }
-
-            if (word[0] != '-') {
+            if (rest > 0 || word[0] != '-' || word.length() == 1 || word == "--") {
                 if (n == 1) {
-                    // the first word does not start with '-', this is not an
-                    // option line, ignore the entire line
+                    // the first word does not start with '-' or is a single
+                    // '-', this is not an option line, ignore the entire line
                     return true;
                 }
 
-                continue; // ignore the word
+                if (++rest > 1) {
+                    break;
+                }
+                restWord = word;
+                continue;
             }
 
             if (word[1] == '-') { // long option
+                std::string spec = word.substr(2);
+                if (spec.back() == ',') {
+                    spec.pop_back();    // e.g. "--out, --output"
+                }
+                if (spec.compare(0, 5, "[no-]") == 0) {
+                    spec.erase(0, 5);
+                    negatable = true;
+                }
 
-                auto pos = word.find_first_of("=");
+                auto pos = spec.find('=', 1);   // pos - 1 is at least 0
                 if (pos == std::string::npos) {
-                    longOpt = word.substr(2);
-                    argReqmt = no_argument;
+                    longOpts.push_back(spec);
                 }
                 else {
-                    if (word[pos - 1] == '[') {
-                        if (word.back() != ']') {
+                    if (spec[pos - 1] == '[') {
+                        if (spec.back() != ']' || pos == 1) {
                             return false;
                         }
-                        longOpt = word.substr(2, pos - 1 - 2);
+                        longOpts.push_back(spec.substr(0, pos - 1));
+                        argName = spec.substr(pos + 1, spec.length() - pos - 2);
                         argReqmt = optional_argument;
                     }
                     else {
-                        longOpt = word.substr(2, pos - 2);
+                        longOpts.push_back(spec.substr(0, pos));
+                        argName = spec.substr(pos + 1);
                         argReqmt = required_argument;
                     }
+                    longArg = true;
+                }
+
+                if (longOpts.back().empty()) {
+                    return false;
                 }
             }
             else { // short option
-                if ( (shortOpt != 0) ||     // set before
-                    ((word.length() == 3) && (word[2] != ',')) || // not end with comma
+                if ( ((word.length() == 3) && (word[2] != ',')) || // not end with comma
                     (word.length() > 3) ) { // extra characters
 
                     return false;
                 }
 
-                shortOpt = word[1];
+                shortOpts += word[1];
             }
         }
 
@@ -641,23 +4566,33 @@ private:
             return true;    // ignore empty lines
         }
 
-        if ( (shortOpt == 0) && longOpt.empty()) {
-            // this should not happen
-            return false;
-        }
-
-        if (longOpt.empty()) {
+        if (longOpts.empty()) {
             // No long option, so we decide the argument requirement by short
             // option. If only one word followed after short option, then
             // argument is required
-            argReqmt = (n == 2)? required_argument: no_argument;
+            argReqmt = (rest == 1)? required_argument: no_argument;
+            argName = restWord; // e.g. "-f FILE"
+        }
+        else if (!longArg) {
+            argReqmt = no_argument;
         }
 
+        if (negatable && argReqmt != no_argument) {
+            return false;   // only a switch can be negated
+        }
 
         bool indexUsed = false;
-        if (shortOpt != 0) {
+        for (char shortOpt : shortOpts) {
+            if (shortOpt == ':' || shortOpt == '+') {
+                addErrorStr(std::string("invalid short option: ") + shortOpt);
+                continue;
+            }
+
+            // like the long form, the short form takes an argument, and it
+            // may be the next element even if the long form's is optional
+            int shortArgReqmt = (argReqmt == no_argument)? no_argument: required_argument;
             m_shortOptStr += shortOpt;
-            if (argReqmt == required_argument || argReqmt == optional_argument) {
+            if (shortArgReqmt == required_argument) {
                 m_shortOptStr += ":";
             }
 
@@ -669,24 +4604,54 @@ private:
             }
             else {
                 m_indexMap[str] = m_maxIndex;
+                m_shortOptions[static_cast<unsigned char>(shortOpt)] = {m_maxIndex, shortArgReqmt};
                 indexUsed = true;
             }
         }
 
-        if (!longOpt.empty()) {
-            m_longOptNames.push_back(longOpt);
-            m_longOptions.push_back({0, argReqmt, 0, shortOpt});    // do not set the pointer at the moment
-
-            if (m_indexMap.find(longOpt) != m_indexMap.end()) {
-                addErrorStr("duplicate long option: " + longOpt);
-            }
-            else {
-                m_indexMap[longOpt] = m_maxIndex;
-                indexUsed = true;
+        // all spellings share the index, a negated one is told apart by the
+        // lowest bit of the value in the trie
+        char shortOpt = shortOpts.empty()? 0: shortOpts[0];
+        for (auto & longOpt : longOpts) {
+            indexUsed = addLongOption(longOpt, argReqmt, shortOpt, false) || indexUsed;
+            if (negatable) {
+                indexUsed = addLongOption("no-" + longOpt, argReqmt, 0, true) || indexUsed;
             }
         }
 
         if (indexUsed) {
+            m_choices.emplace_back();
+            if (argReqmt != no_argument && !argName.empty() && argName[0] == '{' &&
+                    !m_choices.back().build(argName)) {
+                addErrorStr("invalid choices: " + argName);
+            }
+
+            // e.g. "KEY=VALUE"
+            m_maps.push_back((argReqmt != no_argument &&
+                    argName.find('=') != std::string::npos)? std::make_shared<KeyValueMap>(): nullptr);
+
+            // e.g. "ID,..." with ',' separating the elements
+            m_lists.emplace_back();
+            std::size_t len = argName.length();
+            if (argReqmt != no_argument && len > 4 && argName.compare(len - 3, 3, "...") == 0 &&
+                    std::ispunct(static_cast<unsigned char>(argName[len - 4])) && argName[len - 4] != '.') {
+                m_lists.back().list = std::make_shared<ValueList>();
+                m_lists.back().sep = argName[len - 4];
+            }
+
+            // e.g. "NUM:int[1,256]", while "HOST:PORT" is just a placeholder
+            m_constraints.emplace_back();
+            auto colon = argName.find(':');
+            if (argReqmt != no_argument && colon != std::string::npos) {
+                std::string spec = argName.substr(colon + 1);
+                if (!m_constraints.back().compile(spec) &&
+                        spec.find_first_of("[(") != std::string::npos) {
+                    addErrorStr("invalid constraint: " + argName);
+                }
+            }
+
+            m_argReqmts.push_back(argReqmt);
+            m_argNames.push_back((argReqmt == no_argument)? std::string(): argName);
             ++m_maxIndex;
         }
 
@@ -696,19 +4661,96 @@ private:
 private:
     std::string m_usage;
     std::string m_errorStr;
+    std::map<int, std::string> m_helpCache;    // see help()
+    int m_usageLines = 0;   // number of usage lines parsed, see append()
 
     // starting with colon will make getopt() to report colon on missing
     // argument
     std::string m_shortOptStr = ":";
 
-    std::vector<struct option> m_longOptions;
-    std::vector<std::string> m_longOptNames;
+    // always terminated by an empty entry as getopt_long() requires
+    std::vector<struct option> m_longOptions = { {0, 0, 0, 0} };
+    std::deque<std::string> m_longOptNames;
 
     int m_maxIndex = 0;    // used only during building up the maps
     std::map<std::string, int> m_indexMap;
-    std::map<int, StringValue> m_options;
+    std::vector<int> m_argReqmts;   // argument requirement by index
+    std::vector<std::string> m_argNames;    // argument placeholder by index
+    std::vector<ChoiceSet> m_choices;       // allowed values by index
+    std::vector<Constraint> m_constraints;  // type and range by index
+    std::vector<std::shared_ptr<KeyValueMap>> m_maps;  // key=value pairs by index
+
+    // elements of delimited values by index
+    struct DelimitedList
+    {
+        std::shared_ptr<ValueList> list;
+        char sep = 0;
+    };
+    std::vector<DelimitedList> m_lists;
+
+    // short option character to index, so that no lookup is needed for them
+    struct ShortOption
+    {
+        int index;
+        int argReqmt;
+    };
+    ShortOption m_shortOptions[256];
+    PrefixTrie m_longTrie;          // long option name to index
+    NameIndex m_longNames;          // long option names for suggestions
+
+    ParseEngine m_engine = ParseEngine::Native;
+    bool m_exactMatch = false;
+    bool m_requireOrder = false;
+    bool m_passThrough = false;
+    bool m_checkArguments = false;          // see setCheckArguments()
+    std::vector<char *> m_forwarded;   // see forwarded()
+
+    bool m_incremental = false;
+    bool m_recording = false;       // record instead of storing results
+    std::vector<Record> m_records;
+    char** m_unitArgv = nullptr;    // the unit being recorded
+    int m_unitStart = 0;            // also the position of the options stored
+    std::size_t m_unitRecord = 0;
+
+    // where reparse() may take over the old records
+    struct Resync
+    {
+        const std::vector<Record> * old;
+        std::size_t next;   // the old record to check next
+        int delta;          // change of the number of argv elements
+        int from;           // the first element after the edit
+        bool found;
+    };
+    Resync m_resync = Resync();
+
+    std::size_t m_usageErrorSize = 0;   // the errors in the usage text
+    std::vector<Rule> m_rules;
+    std::vector<int> m_ruleOptions;         // indices of the options in rules
+    std::vector<std::uint64_t> m_present;   // options given, see checkRules()
+    // values by index, in a deque so that append() keeps the pointers and
+    // references given out before valid
+    std::deque<StringValue> m_options;
     StringValue m_arguments;
-    StringValue m_nullStrValue;
+    std::vector<char *> m_argList;          // the arguments one by one
+    bool m_usageSeen = false;               // the "Usage:" line was read
+    std::vector<Positional> m_positionals;
+    std::vector<int> m_takes;               // arguments by name, see assignPositionals()
+    std::unordered_map<std::string, int> m_positionalIndex;
+
+    // a subcommand whose options are built on first use
+    struct Subcommand
+    {
+        std::string usage;
+        std::unique_ptr<CmdOption> option;
+    };
+
+    std::unordered_map<std::string, Subcommand> m_subcommands;
+    std::string m_subcommand;   // the selected subcommand
+
+#ifdef CMDOPTION_STATS
+    std::shared_ptr<ParseStats> m_stats = std::make_shared<ParseStats>();
+    std::function<void(const ParseStats &)> m_statsCallback;
+#endif
 };
 
 } // end of namespace tianbo
@@ -0,0 +1,107 @@
+/**
+ * Fuzz target for the command line
+ *
+ * The usage text is fixed and uses all kinds of options. The input is split
+ * at NUL bytes into the elements of argv, and the first byte selects the
+ * parse engine and modes. In incremental mode the command line may also be
+ * parsed without one of its elements first, and then again with reparse()
+ * after the element is inserted.
+ */
+
+#include "CmdOption.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+static const char * const USAGE = R"(
+Usage: prog [options] SRC... DST:int [MODE]
+
+Options:
+-a, --all                     all of them
+-b                            the b switch
+-v, --verbose                 more output, may be repeated
+-o, --out, --output=FILE      where to write
+-O, --opt[=LEVEL]             optimize
+--[no-]color                  colour the output
+-m, --mode={fast,safe,debug}  how to run
+-t, --threads=NUM:int[1,256]  number of threads
+--ratio=X:double(0,1]         ratio to keep
+-D, --define=KEY=VALUE        set a variable
+--ids=ID,...                  the records to process
+--cache=SIZE                  cache size
+--timeout=TIME                time limit
+
+Required: --out
+Exclusive: --all -b
+Requires: --ratio --threads
+)";
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t * data, std::size_t size)
+{
+    if (size == 0) {
+        return 0;
+    }
+
+    unsigned char mode = data[0];
+    std::vector<std::string> words;
+    std::size_t start = 1;
+    for (std::size_t i = 1; i <= size; ++i) {
+        if (i == size || data[i] == '\0') {
+            words.emplace_back(reinterpret_cast<const char *>(data) + start, i - start);
+            start = i + 1;
+        }
+    }
+
+    std::vector<char *> args;
+    args.push_back(const_cast<char *>("prog"));
+    for (std::string & word : words) {
+        args.push_back(&word[0]);
+    }
+    args.push_back(nullptr);
+
+    tianbo::CmdOption opt;
+    opt << USAGE;
+    if (mode & 1) {
+        opt.setParseEngine(tianbo::ParseEngine::Getopt);
+    }
+    else {
+        opt.setPassThrough(mode & 2);
+        opt.setIncremental(mode & 4);
+    }
+    opt.setRequireOrder(mode & 8);
+    opt.setExactMatch(mode & 16);
+    opt.setCheckArguments(mode & 32);
+
+    int argc = static_cast<int>(args.size()) - 1;
+    if ((mode & 64) && argc > 1) {
+        int edit = 1 + static_cast<int>(size % (argc - 1));
+        std::vector<char *> before(args);
+        before.erase(before.begin() + edit);
+        opt.parse(argc - 1, before.data());
+        opt.reparse(argc, args.data(), edit, 0, 1);
+    }
+    else {
+        opt.parse(argc, args.data());
+    }
+
+    for (const char * name : {"all", "b", "verbose", "out", "opt", "color", "mode",
+            "threads", "ratio", "define", "ids", "cache", "timeout"}) {
+        tianbo::StringValue & value = *opt.tryGet(name).value();
+        value.tryAs<int>();
+        value.tryAs<double>();
+        value.tryAs<std::vector<long>>();
+        value.tryAs<tianbo::ByteSize>();
+        value.tryAs<std::chrono::milliseconds>();
+        value.choice();
+        value.negated();
+        value.map().valueOr("k", "");
+        value.list().tryAs<long>();
+    }
+    opt.arguments().tryAs<std::vector<std::string>>();
+    opt.positional("SRC").tryAs<std::vector<std::string>>();
+    opt.positional("DST").tryAs<int>();
+    return 0;
+}
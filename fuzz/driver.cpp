@@ -0,0 +1,91 @@
+/**
+ * Driver for the fuzz targets where libFuzzer is not available
+ *
+ * With file arguments, each file is run once, e.g. to replay a crash found by
+ * libFuzzer. Otherwise random inputs are built from a dictionary of the
+ * tokens CmdOption looks for, and the number of runs per second is printed.
+ *
+ * Usage: <target> [runs] [seed]
+ *        <target> FILE...
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t * data, std::size_t size);
+
+static const char * const TOKENS[] = {
+    "-", "--", "-a", "-b,", "-v", "-vv", "--all", "--out=", "--output", "--no-color",
+    "--[no-]", "--x=", "[=N]", "=", "[", "]", "{", "}", ",", ":", "...", "FILE",
+    "KEY=VALUE", "ID,...", "{fast,safe}", "NUM:int[1,4]", ":double(0,1]", "fast",
+    "k=v", "1,2,3", "512M", "1h30m", "10k/s", "+1", "-5", "0x10", "1e3", "desc",
+    "Usage: prog [options] SRC... DST:int\n", "Required: --out\n",
+    "Exclusive: --all -b\n", "Requires: --a --b\n", "\n", "  ", "\t", "\0", "\xff",
+};
+
+static bool isNumber(const char * str)
+{
+    if (*str == '\0') {
+        return false;
+    }
+    for (; *str != '\0'; ++str) {
+        if (*str < '0' || *str > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int runFiles(int argc, char ** argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream in(argv[i], std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::printf("running %s (%zu bytes)\n", argv[i], data.size());
+        LLVMFuzzerTestOneInput(reinterpret_cast<const std::uint8_t *>(data.data()), data.size());
+    }
+    return 0;
+}
+
+int main(int argc, char ** argv)
+{
+    if (argc > 1 && !isNumber(argv[1])) {
+        return runFiles(argc, argv);
+    }
+
+    long runs = (argc > 1)? std::strtol(argv[1], nullptr, 10): 100000;
+    unsigned seed = (argc > 2)? std::strtoul(argv[2], nullptr, 10): 1;
+    std::mt19937 rng(seed);
+    const std::size_t tokens = sizeof(TOKENS) / sizeof(TOKENS[0]);
+
+    auto start = std::chrono::steady_clock::now();
+    std::string data;
+    for (long run = 0; run < runs; ++run) {
+        data.clear();
+        data += static_cast<char>(rng());
+        int n = rng() % 24;
+        for (int i = 0; i < n; ++i) {
+            std::size_t t = rng() % tokens;
+            if (TOKENS[t][0] == '\0') {
+                data += '\0';
+            }
+            else {
+                data += TOKENS[t];
+            }
+            if (rng() % 3 == 0) {
+                data += (rng() % 2)? ' ': '\0';
+            }
+        }
+        LLVMFuzzerTestOneInput(reinterpret_cast<const std::uint8_t *>(data.data()), data.size());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%ld runs in %.2f s, %.0f exec/s\n", runs, seconds, runs / seconds);
+    return 0;
+}
@@ -0,0 +1,40 @@
+/**
+ * Fuzz target for the usage text
+ *
+ * The input is used as the usage text, which is then used to parse a fixed
+ * command line and to generate the help, the completions and suggestions.
+ */
+
+#include "CmdOption.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t * data, std::size_t size)
+{
+    std::string usage(reinterpret_cast<const char *>(data), size);
+
+    tianbo::CmdOption opt;
+    opt << usage;
+
+    const char * args[] = {"prog", "-a", "-bc", "--all", "--out=x", "--no-color",
+            "--mo", "fast", "-v", "-v", "file", "--", "-x", nullptr};
+    opt.parse(sizeof(args) / sizeof(args[0]) - 1, const_cast<char **>(args));
+
+    for (const char * name : {"a", "b", "all", "out", "color", "mode", "v"}) {
+        auto value = opt.tryGet(name);
+        if (value) {
+            value.value()->tryAs<long>();
+            value.value()->list().size();
+            value.value()->map().size();
+        }
+    }
+    opt.arguments().tryAs<std::string>();
+    opt.suggest("--colr");
+    opt.help(60);
+    opt.completionScript(tianbo::Shell::Bash, "prog");
+    opt.completionScript(tianbo::Shell::Zsh, "prog");
+    opt.completionScript(tianbo::Shell::Fish, "prog");
+    return 0;
+}
@@ -0,0 +1,177 @@
+/**
+ * Differential test of the parse engines
+ *
+ * Random usage texts and command lines are parsed with ParseEngine::Native
+ * and ParseEngine::Getopt, and the options, arguments and success of both
+ * must be the same. Each case is timed with both engines, and the speedup of
+ * the native engine is reported per case and in total.
+ *
+ * Usage: differential [cases] [seed]
+ */
+
+#include "CmdOption.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using tianbo::CmdOption;
+using tianbo::ParseEngine;
+
+static std::mt19937 rng;
+
+// options a-f and long options such as "--lbx", with all kinds of arguments
+static std::string randomUsage(std::vector<std::string> & names)
+{
+    std::string usage;
+    std::set<char> used;
+    int count = 1 + rng() % 6;
+    for (int i = 0; i < count; ++i) {
+        char shortOpt = 'a' + rng() % 6;
+        bool hasShort = rng() % 3 != 0 && used.count(shortOpt) == 0;
+        bool hasLong = rng() % 3 != 0 || !hasShort;
+        std::string longOpt = std::string("l") + char('a' + rng() % 4) + ((rng() % 2)? "x": "xy");
+        int argReqmt = rng() % 3;
+        if (hasLong && std::find(names.begin(), names.end(), longOpt) != names.end()) {
+            hasLong = false;
+        }
+        if (!hasShort && !hasLong) {
+            continue;
+        }
+
+        std::string line;
+        if (hasShort) {
+            used.insert(shortOpt);
+            line += std::string("-") + shortOpt + " ";
+            names.push_back(std::string(1, shortOpt));
+        }
+        if (hasLong) {
+            line += "--" + longOpt + ((argReqmt == 1)? "=N": (argReqmt == 2)? "[=N]": "") + " desc";
+            names.push_back(longOpt);
+        }
+        else {
+            line += (argReqmt != 0)? "FILE": " desc";
+        }
+        usage += line + "\n";
+    }
+    return usage;
+}
+
+static std::vector<std::string> randomArgs()
+{
+    std::vector<std::string> args{"prog"};
+    int count = rng() % 7;
+    for (int i = 0; i < count; ++i) {
+        int kind = rng() % 8;
+        std::string arg;
+        if (kind == 0) {
+            arg = "op" + std::to_string(i);
+        }
+        else if (kind == 1) {
+            arg = "--";
+        }
+        else if (kind <= 4) {
+            arg = "-";
+            for (int n = 1 + rng() % 3; n > 0; --n) {
+                arg += char('a' + rng() % 7);
+            }
+        }
+        else {
+            arg = std::string("--l") + char('a' + rng() % 5);
+            int n = rng() % 3;
+            arg += (n > 0)? "x": "";
+            arg += (n > 1)? "y": "";
+            arg += (rng() % 3 == 0)? "=v": "";
+        }
+        args.push_back(arg);
+    }
+    return args;
+}
+
+static std::string result(CmdOption & opt, const std::vector<std::string> & names)
+{
+    std::string str;
+    for (auto & name : names) {
+        tianbo::StringValue & value = *opt.tryGet(name).value();
+        str += name + "=" + std::to_string(value.count()) + ":" + value.valueOr(std::string("<>")) + ";";
+    }
+    str += "|args=" + opt.arguments().valueOr(std::string("<>"));
+    str += opt.good()? "|ok": "|error";
+    return str;
+}
+
+// parse the command line a number of times, getopt_long() permutes argv so
+// every run gets its own copy of it
+static double parseTime(CmdOption & opt, const std::vector<std::string> & args, int runs)
+{
+    std::vector<std::vector<std::string>> copies(runs, args);
+    std::vector<std::vector<char *>> argvs(runs);
+    for (int run = 0; run < runs; ++run) {
+        for (auto & arg : copies[run]) {
+            argvs[run].push_back(&arg[0]);
+        }
+        argvs[run].push_back(nullptr);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < runs; ++run) {
+        opt.reset();
+        opt.parse(static_cast<int>(args.size()), argvs[run].data());
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char ** argv)
+{
+    long cases = (argc > 1)? std::atol(argv[1]): 20000;
+    rng.seed((argc > 2)? std::atol(argv[2]): 99);
+    const int runs = 20;
+
+    long diffs = 0;
+    double native = 0;
+    double getopt = 0;
+    std::vector<double> speedups;
+    for (long i = 0; i < cases; ++i) {
+        std::vector<std::string> names;
+        std::string usage = randomUsage(names);
+        std::vector<std::string> args = randomArgs();
+
+        CmdOption opts[2];
+        double seconds[2];
+        std::string results[2];
+        for (int e = 0; e < 2; ++e) {
+            opts[e] << usage;
+            opts[e].setParseEngine((e == 0)? ParseEngine::Native: ParseEngine::Getopt);
+            seconds[e] = parseTime(opts[e], args, runs);
+            results[e] = result(opts[e], names);
+        }
+        native += seconds[0];
+        getopt += seconds[1];
+        speedups.push_back(seconds[1] / seconds[0]);
+
+        if (results[0] != results[1] && ++diffs <= 8) {
+            std::printf("usage:\n%sargv:", usage.c_str());
+            for (auto & arg : args) {
+                std::printf(" %s", arg.c_str());
+            }
+            std::printf("\n  native: %s\n  getopt: %s\n\n", results[0].c_str(), results[1].c_str());
+        }
+    }
+
+    std::sort(speedups.begin(), speedups.end());
+    auto percentile = [&](double p) {
+        return speedups[static_cast<std::size_t>(p * (speedups.size() - 1))];
+    };
+    std::printf("%ld cases, %ld differences\n", cases, diffs);
+    std::printf("speedup of the native engine per case: min %.2fx, p10 %.2fx, median %.2fx, "
+            "p90 %.2fx, max %.2fx\n", percentile(0), percentile(0.1), percentile(0.5),
+            percentile(0.9), percentile(1));
+    std::printf("total: native %.1f ms, getopt %.1f ms, speedup %.2fx\n",
+            native * 1e3, getopt * 1e3, getopt / native);
+    return (diffs == 0)? EXIT_SUCCESS: EXIT_FAILURE;
+}
@@ -0,0 +1,217 @@
+/**
+ * Randomized test of reparse()
+ *
+ * Random command lines are parsed incrementally and edited a few times, and
+ * after each reparse() the options, arguments, forwarded elements and errors
+ * must be the same as those of a fresh parse() of the edited command line.
+ *
+ * Usage: reparse [cases] [seed]
+ */
+
+#include "CmdOption.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using tianbo::CmdOption;
+
+static std::mt19937 rng;
+
+// options a-f and long options such as "--lbx", with arguments that are
+// free, optional, one of a few choices, a bounded number, key=value pairs
+// or a list
+static std::string randomUsage(std::vector<std::string> & names)
+{
+    static const char * const ARGS[] = {"", "=N", "[=N]", "={fast,safe}", "=N:int[1,4]",
+            "=KEY=VALUE", "=ID,..."};
+
+    std::string usage;
+    std::set<char> used;
+    int count = 1 + rng() % 6;
+    for (int i = 0; i < count; ++i) {
+        char shortOpt = 'a' + rng() % 6;
+        bool hasShort = rng() % 3 != 0 && used.count(shortOpt) == 0;
+        bool hasLong = rng() % 3 != 0 || !hasShort;
+        std::string longOpt = std::string("l") + char('a' + rng() % 4) + ((rng() % 2)? "x": "xy");
+        const char * arg = ARGS[rng() % 7];
+        if (hasLong && std::find(names.begin(), names.end(), longOpt) != names.end()) {
+            hasLong = false;
+        }
+        if (!hasShort && !hasLong) {
+            continue;
+        }
+
+        std::string line;
+        if (hasShort) {
+            used.insert(shortOpt);
+            line += std::string("-") + shortOpt + " ";
+            names.push_back(std::string(1, shortOpt));
+        }
+        if (hasLong) {
+            line += "--" + longOpt + arg + " desc";
+            names.push_back(longOpt);
+        }
+        else {
+            line += (*arg != '\0')? "FILE": " desc";
+        }
+        usage += line + "\n";
+    }
+    return usage;
+}
+
+static std::string randomArg(int i)
+{
+    static const char * const VALUES[] = {"=v", "=fast", "=bad", "=3", "=9", "=k=1", "=1,2"};
+
+    int kind = rng() % 9;
+    std::string arg;
+    if (kind == 0) {
+        arg = "op" + std::to_string(i);
+    }
+    else if (kind == 1) {
+        arg = (rng() % 3 != 0)? "--": "-";
+    }
+    else if (kind == 2) {
+        arg = VALUES[rng() % 7] + 1;
+    }
+    else if (kind <= 5) {
+        arg = "-";
+        for (int n = 1 + rng() % 3; n > 0; --n) {
+            arg += char('a' + rng() % 7);
+        }
+    }
+    else {
+        arg = std::string("--l") + char('a' + rng() % 5);
+        int n = rng() % 3;
+        arg += (n > 0)? "x": "";
+        arg += (n > 1)? "y": "";
+        arg += (rng() % 2 == 0)? VALUES[rng() % 7]: "";
+    }
+    return arg;
+}
+
+static std::string result(CmdOption & opt, const std::vector<std::string> & names)
+{
+    std::string str;
+    for (auto & name : names) {
+        tianbo::StringValue & value = *opt.tryGet(name).value();
+        str += name + "=" + std::to_string(value.count()) + ":" + value.valueOr(std::string("<>")) +
+                ":" + std::to_string(value.choice());
+        for (auto & pair : value.map()) {
+            str += ":" + std::string(pair.first) + "=" + std::string(pair.second);
+        }
+        for (auto & element : value.list()) {
+            str += ":" + std::string(element);
+        }
+        str += ";";
+    }
+    str += "|args=" + opt.arguments().valueOr(std::string("<>")) + "|forwarded=";
+    for (char * arg : opt.forwarded()) {
+        str += (arg != nullptr)? std::string(arg) + ",": "<null>";
+    }
+
+    std::ostringstream errors;
+    opt.reportError(errors);
+    return str + "|errors=" + errors.str();
+}
+
+// the strings of argv, kept alive as long as the parser refers to them
+struct Args
+{
+    std::vector<std::string> strings;
+    std::vector<char *> argv;
+
+    explicit Args(const std::vector<std::string> & args)
+        : strings(args)
+    {
+        for (auto & str : strings) {
+            argv.push_back(&str[0]);
+        }
+        argv.push_back(nullptr);
+    }
+
+    int argc() const
+    {
+        return static_cast<int>(strings.size());
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    long cases = (argc > 1)? std::atol(argv[1]): 20000;
+    rng.seed((argc > 2)? std::atol(argv[2]): 7);
+
+    long failures = 0;
+    for (long i = 0; i < cases; ++i) {
+        std::vector<std::string> names;
+        std::string usage = randomUsage(names);
+        bool passThrough = rng() % 3 == 0;
+        bool requireOrder = rng() % 3 == 0;
+
+        std::vector<std::string> args{"prog"};
+        for (int n = rng() % 7; n > 0; --n) {
+            args.push_back(randomArg(n));
+        }
+
+        CmdOption opt;
+        opt << usage;
+        opt.setIncremental(true);
+        opt.setPassThrough(passThrough);
+        opt.setRequireOrder(requireOrder);
+        std::unique_ptr<Args> line(new Args(args));
+        opt.parse(line->argc(), line->argv.data());
+
+        for (int edit = 0; edit < 3; ++edit) {
+            int first = 1 + rng() % args.size();
+            int removed = std::min<int>(rng() % 3, args.size() - first);
+            int inserted = rng() % 3;
+            std::vector<std::string> edited(args.begin(), args.begin() + first);
+            for (int n = 0; n < inserted; ++n) {
+                edited.push_back(randomArg(n));
+            }
+            edited.insert(edited.end(), args.begin() + first + removed, args.end());
+
+            // the old command line is overwritten and freed, nothing may
+            // refer to it after reparse()
+            std::unique_ptr<Args> next(new Args(edited));
+            opt.reparse(next->argc(), next->argv.data(), first, removed, inserted);
+            for (auto & str : line->strings) {
+                std::fill(str.begin(), str.end(), '#');
+            }
+            line = std::move(next);
+
+            CmdOption fresh;
+            fresh << usage;
+            fresh.setPassThrough(passThrough);
+            fresh.setRequireOrder(requireOrder);
+            Args copy(edited);
+            fresh.parse(copy.argc(), copy.argv.data());
+
+            std::string expected = result(fresh, names);
+            std::string actual = result(opt, names);
+            if (actual != expected && ++failures <= 5) {
+                std::printf("usage:\n%sbefore:", usage.c_str());
+                for (auto & arg : args) {
+                    std::printf(" %s", arg.c_str());
+                }
+                std::printf("\nafter:");
+                for (auto & arg : edited) {
+                    std::printf(" %s", arg.c_str());
+                }
+                std::printf("\nedit at %d, %d removed, %d inserted\n  reparse: %s\n  parse:   %s\n\n",
+                        first, removed, inserted, actual.c_str(), expected.c_str());
+            }
+            args = edited;
+        }
+    }
+
+    std::printf("%ld cases, %ld failures\n", cases, failures);
+    return (failures == 0)? EXIT_SUCCESS: EXIT_FAILURE;
+}
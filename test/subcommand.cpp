@@ -0,0 +1,87 @@
+/**
+ * Test of subcommands
+ *
+ * A subcommand must be parsed with the settings of the tool, and in
+ * pass-through mode what it forwards must follow what the tool forwards.
+ *
+ * Usage: subcommand
+ */
+
+#include "CmdOption.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using tianbo::CmdOption;
+
+static int failures = 0;
+
+static void check(bool ok, const char * what)
+{
+    if (!ok) {
+        std::printf("failed: %s\n", what);
+        ++failures;
+    }
+}
+
+static std::string forwarded(CmdOption & opt)
+{
+    std::string result;
+    for (char * arg : opt.forwarded()) {
+        result += (arg != nullptr)? std::string(arg) + " ": "<null>";
+    }
+    return result;
+}
+
+int main()
+{
+    // pass-through: the unknown options of both the tool and the
+    // subcommand are forwarded, in the order they are given
+    {
+        CmdOption opt;
+        opt << "-v  be verbose";
+        opt.addSubcommand("build", "-j, --jobs=N  number of jobs");
+        opt.setPassThrough(true);
+        const char * argv[] = {"tool", "-x", "-v", "build", "-j", "2", "--unknown", "file", nullptr};
+        opt.parse(8, const_cast<char **>(argv));
+
+        check(opt.good(), "pass-through: no error");
+        check(opt.subcommand() == "build", "pass-through: subcommand selected");
+        check(forwarded(opt) == "tool -x build --unknown file <null>",
+                "pass-through: forwarded elements merged");
+        CmdOption * sub = opt.subcommandOption();
+        check(sub != nullptr && (*sub)["jobs"].as<int>() == 2, "pass-through: subcommand option");
+    }
+
+    // exact match: an abbreviation is rejected by the subcommand too
+    {
+        CmdOption opt;
+        opt << "-v  be verbose";
+        opt.addSubcommand("build", "--precision=N  number of digits");
+        opt.setExactMatch(true);
+        const char * argv[] = {"tool", "build", "--prec=3", nullptr};
+        opt.parse(3, const_cast<char **>(argv));
+
+        check(!opt.good(), "exact match: abbreviation rejected");
+    }
+
+    // require order: the subcommand stops at its first argument
+    {
+        CmdOption opt;
+        opt << "-v  be verbose";
+        opt.addSubcommand("build", "-j, --jobs=N  number of jobs");
+        opt.setRequireOrder(true);
+        const char * argv[] = {"tool", "build", "file", "-j", "2", nullptr};
+        opt.parse(5, const_cast<char **>(argv));
+
+        CmdOption * sub = opt.subcommandOption();
+        check(opt.good(), "require order: no error");
+        check(sub != nullptr && !(*sub)["jobs"], "require order: option after argument");
+        check(sub != nullptr && sub->arguments().count() == 3, "require order: arguments");
+    }
+
+    std::printf("%d failures\n", failures);
+    return (failures == 0)? EXIT_SUCCESS: EXIT_FAILURE;
+}
@@ -0,0 +1,286 @@
+/**
+ * Test of the values of options and arguments
+ *
+ * Each case checks a conversion or a declaration of the usage text against
+ * the expected result, including the edges such as overflow and the bounds
+ * of a range.
+ *
+ * Usage: values
+ */
+
+#include "CmdOption.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using tianbo::ByteSize;
+using tianbo::CmdOption;
+using tianbo::Rate;
+
+static int failures = 0;
+
+static void check(bool ok, const char * what)
+{
+    if (!ok) {
+        std::printf("failed: %s\n", what);
+        ++failures;
+    }
+}
+
+// parses the command line, which is split at spaces
+static bool parse(CmdOption & opt, const std::string & line)
+{
+    static std::vector<std::string> words;
+    static std::vector<char *> argv;
+    words.assign(1, "prog");
+    std::size_t start = 0;
+    while (start < line.length()) {
+        std::size_t end = line.find(' ', start);
+        end = (end == std::string::npos)? line.length(): end;
+        words.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+    argv.clear();
+    for (auto & word : words) {
+        argv.push_back(&word[0]);
+    }
+    argv.push_back(nullptr);
+
+    opt.reset();
+    opt.parse(static_cast<int>(words.size()), argv.data());
+    return opt.good();
+}
+
+template<typename T>
+static bool converts(const char * str, T & v)
+{
+    return tianbo::ValueParser<T>::parse(str, v);
+}
+
+static void testSizes()
+{
+    ByteSize size;
+    check(converts("0", size) && size.bytes == 0, "size 0");
+    check(converts("512", size) && size.bytes == 512, "size 512");
+    check(converts("1B", size) && size.bytes == 1, "size 1B");
+    check(converts("4k", size) && size.bytes == 4096, "size 4k");
+    check(converts("512M", size) && size.bytes == 512ull << 20, "size 512M");
+    check(converts("1.5GiB", size) && size.bytes == 3ull << 29, "size 1.5GiB");
+    check(converts("15E", size) && size.bytes == 15ull << 60, "size 15E");
+    check(!converts("16E", size), "size 16E overflows");
+    check(converts("1.5", size) && size.bytes == 2, "size 1.5 rounds");
+    check(!converts("1X", size), "size unknown unit");
+    check(!converts("-1k", size), "size negative");
+    check(!converts("k", size), "size without number");
+    check(!converts(" 1k", size), "size leading space");
+}
+
+static void testDurations()
+{
+    std::chrono::seconds s;
+    std::chrono::milliseconds ms;
+    std::chrono::duration<double> real;
+    check(converts("0", s) && s.count() == 0, "duration 0");
+    check(converts("90s", s) && s.count() == 90, "duration 90s");
+    check(converts("1h30m", s) && s.count() == 5400, "duration 1h30m");
+    check(converts("1h30m", ms) && ms.count() == 5400000, "duration 1h30m in ms");
+    check(converts("1500ms", ms) && ms.count() == 1500, "duration 1500ms");
+    check(!converts("1500ms", s), "duration 1500ms in seconds");
+    check(converts("2000ms", s) && s.count() == 2, "duration 2000ms in seconds");
+    check(converts("1500ms", real) && real.count() == 1.5, "duration 1500ms in double seconds");
+    check(converts("1.5s", ms) && ms.count() == 1500, "duration 1.5s");
+    check(converts("2d", s) && s.count() == 172800, "duration 2d");
+    check(!converts("30", s), "duration without unit");
+    check(!converts("30x", s), "duration unknown unit");
+    check(!converts("1h30", s), "duration trailing number");
+    check(!converts("", s), "duration empty");
+    check(!converts("200000000h", ms), "duration overflow");
+}
+
+static void testRates()
+{
+    Rate rate;
+    check(converts("10k/s", rate) && rate.perSecond == 10000, "rate 10k/s");
+    check(converts("300/min", rate) && rate.perSecond == 5, "rate 300/min");
+    check(converts("1.5M/s", rate) && rate.perSecond == 1500000, "rate 1.5M/s");
+    check(converts("36/h", rate) && rate.perSecond == 0.01, "rate 36/h");
+    check(!converts("10k", rate), "rate without time unit");
+    check(!converts("10x/s", rate), "rate unknown multiple");
+    check(!converts("10/y", rate), "rate unknown time unit");
+}
+
+static void testNumbers()
+{
+    int i;
+    double d;
+    float f;
+    check(converts("+7", i) && i == 7, "int +7");
+    check(converts("-7", i) && i == -7, "int -7");
+    check(!converts("+-7", i), "int +-7");
+    check(!converts("7x", i), "int 7x");
+    check(!converts("2147483648", i), "int overflow");
+    check(converts("1e3", d) && d == 1000, "double 1e3");
+    check(converts("-0.25", d) && d == -0.25, "double -0.25");
+    check(!converts("1e999", d), "double overflow");
+    check(!converts("1e39", f), "float overflow");
+    check(!converts(" 1", d), "double leading space");
+}
+
+static void testRanges()
+{
+    CmdOption opt;
+    opt << "-t, --threads=NUM:int[1,256]  number of threads\n"
+           "--ratio=X:double(0,1]  ratio to keep\n"
+           "--level=N:int[-5,5]  level";
+    check(opt.good(), "range usage");
+
+    check(parse(opt, "--threads=1") && opt["threads"].as<int>() == 1, "int[1,256] low bound");
+    check(parse(opt, "--threads=256") && opt["threads"].as<int>() == 256, "int[1,256] high bound");
+    check(!parse(opt, "--threads=0"), "int[1,256] below");
+    check(!parse(opt, "--threads=257"), "int[1,256] above");
+    check(!parse(opt, "--threads=1.5"), "int[1,256] fraction");
+    check(!parse(opt, "--threads=x"), "int[1,256] not a number");
+    check(parse(opt, "--level=-5 --level=5"), "int[-5,5] bounds");
+    check(!parse(opt, "--level=-6"), "int[-5,5] below");
+    check(parse(opt, "--ratio=1"), "double(0,1] closed high bound");
+    check(!parse(opt, "--ratio=0"), "double(0,1] open low bound");
+    check(parse(opt, "--ratio=0.001"), "double(0,1] inside");
+    check(!parse(opt, "--ratio=1.001"), "double(0,1] above");
+}
+
+static void testChoices()
+{
+    CmdOption opt;
+    opt << "-m, --mode={fast,safe,debug}  how to run";
+    check(parse(opt, "--mode=safe") && opt["mode"].choice() == 1, "choice safe");
+    check(parse(opt, "-m debug") && opt["mode"].choice() == 2, "choice with short option");
+    check(parse(opt, "--mode=fast --mode=debug") && opt["mode"].choice() == 2, "choice last wins");
+    check(!parse(opt, "--mode=slow"), "choice not listed");
+    check(!parse(opt, "--mode=Fast"), "choice case");
+    check(parse(opt, "") && opt["mode"].choice() == -1, "choice not given");
+
+    // too many words for a small perfect hash table
+    std::string list;
+    for (int i = 0; i < 200; ++i) {
+        list += (list.empty()? "{": ",") + std::string("w") + std::to_string(i);
+    }
+    CmdOption many;
+    many << "--word=" + list + "}  one of many";
+    check(parse(many, "--word=w0") && many["word"].choice() == 0, "long choice first");
+    check(parse(many, "--word=w199") && many["word"].choice() == 199, "long choice last");
+    check(!parse(many, "--word=w200"), "long choice not listed");
+
+    CmdOption twice;
+    twice << "--mode={fast,safe,fast}  how to run";
+    check(!twice.good(), "choice duplicate");
+}
+
+static void testMapsAndLists()
+{
+    CmdOption opt;
+    opt << "-D, --define=KEY=VALUE  set a variable\n"
+           "--ids=ID,...  the records to process";
+
+    check(parse(opt, "-D a=1 --define=b= -D c -D a=2"), "map parse");
+    const tianbo::KeyValueMap & map = opt["define"].map();
+    check(map.size() == 3, "map size");
+    check(map.valueOr("a", "") == "2", "map later value wins");
+    check(map.find("b") != nullptr && map.find("b")->empty(), "map empty value");
+    check(map.find("c") != nullptr && map.find("c")->empty(), "map key without '='");
+    check(map.find("d") == nullptr, "map missing key");
+
+    check(parse(opt, "--ids=1,2 --ids=3"), "list parse");
+    auto ids = opt["ids"].list().tryAs<long>();
+    check(ids && ids.value() == std::vector<long>({1, 2, 3}), "list elements");
+    check(parse(opt, "--ids=1,,x") && !opt["ids"].list().tryAs<long>(), "list invalid element");
+    check(opt["ids"].list().size() == 3, "list empty element");
+}
+
+static void testRules()
+{
+    CmdOption opt;
+    opt << "-i, --input=FILE  the input\n"
+           "--fast  be fast\n"
+           "--safe  be safe\n"
+           "-o, --output=FILE  the output\n"
+           "--format=NAME  the format\n"
+           "\n"
+           "Required: --input\n"
+           "Exclusive: --fast --safe\n"
+           "Requires: --output --format";
+    check(opt.good(), "rules usage");
+
+    check(parse(opt, "-i x"), "rules met");
+    check(!parse(opt, ""), "required missing");
+    check(!parse(opt, "-i x --fast --safe"), "exclusive both");
+    check(parse(opt, "-i x --safe"), "exclusive one");
+    check(!parse(opt, "-i x -o y"), "requires missing");
+    check(parse(opt, "-i x -o y --format=z"), "requires met");
+}
+
+static void testPositionals()
+{
+    CmdOption opt;
+    opt << "Usage: copy [options] SRC... DST:int [MODE]\n"
+           "-v, --verbose  more output";
+    opt.setCheckArguments(true);
+
+    check(parse(opt, "a 3"), "least arguments");
+    check(opt.positional("SRC").str() == "a", "repeated takes one");
+    check(opt.positional("DST").as<int>() == 3, "typed positional");
+    check(!opt.positional("MODE"), "optional not given");
+    check(parse(opt, "a 3 fast") && opt.positional("MODE").str() == "fast", "optional before repeated");
+    check(opt.positional(0).count() == 1, "positional by position");
+    check(parse(opt, "a b 3 fast") && opt.positional("SRC").count() == 2, "repeated takes the rest");
+    check(opt.positional("DST").as<int>() == 3 && opt.positional("MODE").str() == "fast",
+            "names after the repeated one");
+    check(!parse(opt, "a"), "missing argument");
+    check(!parse(opt, "a b"), "invalid typed argument");
+    check(!opt.tryPositional("NONE"), "unknown name");
+    check(opt.arguments().count() == 2, "all arguments kept");
+
+    CmdOption free;
+    free << "Usage: copy [options] SRC DST:int\n"
+            "-v, --verbose  more output";
+    check(parse(free, "a b c"), "arguments not checked by default");
+}
+
+static void testSwitches()
+{
+    CmdOption opt;
+    opt << "-v, --verbose  more output, may be repeated\n"
+           "-o, --out, --output=FILE  where to write\n"
+           "--[no-]color  colour the output";
+
+    check(parse(opt, "-vvv --verbose") && opt["v"].count() == 4, "switch count");
+    check(parse(opt, "") && opt["verbose"].count() == 0, "switch not given");
+    check(parse(opt, "--out=a") && opt["output"].str() == "a", "alias --out");
+    check(parse(opt, "--output b") && opt["o"].str() == "b", "alias --output");
+    check(parse(opt, "--color") && opt["color"].flagOr(false), "negatable given");
+    check(parse(opt, "--no-color") && !opt["color"].flagOr(true) && opt["color"].negated(),
+            "negated");
+    check(parse(opt, "--no-color --color") && opt["color"].flagOr(false), "last of negation wins");
+    check(parse(opt, "") && opt["color"].flagOr(true), "negatable default");
+    check(!parse(opt, "--no-verbose"), "not negatable");
+}
+
+int main()
+{
+    testSizes();
+    testDurations();
+    testRates();
+    testNumbers();
+    testRanges();
+    testChoices();
+    testMapsAndLists();
+    testRules();
+    testPositionals();
+    testSwitches();
+
+    std::printf("%d failures\n", failures);
+    return (failures == 0)? EXIT_SUCCESS: EXIT_FAILURE;
+}